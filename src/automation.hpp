@@ -0,0 +1,76 @@
+/*
+    This file is part of eVerb
+
+    Copyright (C) 2015-2025  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+
+namespace everb {
+
+/** The shortest run of frames a block is split into for parameter events.
+
+    Events less than this many frames after the start of a run are applied together at its
+    start, so a dense automation lane costs at most one engine update per run rather than one
+    per event. The engine smooths every change over a few milliseconds anyway, so moving one
+    by under a millisecond is not audible.
+*/
+static constexpr int automationGranularity = 32;
+
+/** The shortest run when rendering offline, where a bounce finishing sooner matters more
+    than every event landing on its frame. Runs this long cost about half as much per frame
+    as runs of automationGranularity. Events then take effect up to this many frames early,
+    see the README for how far that moves the output.
+*/
+static constexpr int offlineAutomationGranularity = 128;
+
+/** Renders a block of numFrames in runs split at the times of its events.
+
+    timeOf (i) gives the frame of event i, with events in time order as hosts deliver them.
+    apply (i) takes event i before the run it falls in is rendered, and render (start, num)
+    renders num frames from start with everything applied so far. Runs are at least
+    granularity frames long, except the last.
+*/
+template <typename TimeOf, typename Apply, typename Render>
+void renderAutomated (const int numFrames, const int numEvents, TimeOf&& timeOf, Apply&& apply, Render&& render,
+                      const int granularity = automationGranularity) {
+    int start = 0, next = 0;
+    while (start < numFrames) {
+        const int coalesced = std::min (numFrames, start + granularity);
+        int end             = numFrames;
+
+        for (; next < numEvents; ++next) {
+            const int time = static_cast<int> (timeOf (next));
+            if (time >= coalesced) {
+                end = std::min (numFrames, time);
+                break;
+            }
+
+            apply (next);
+        }
+
+        render (start, end - start);
+        start = end;
+    }
+
+    // Events stamped past the end of the block still count, as of its end.
+    for (; next < numEvents; ++next)
+        apply (next);
+}
+
+} // namespace everb
@@ -0,0 +1,432 @@
+/*
+    This file is part of eVerb
+
+    Copyright (C) 2015-2025  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Compares the cost of the comb and network tanks at each quality tier against the echo
+// density they reach, so the cheaper engine for a given density can be picked, and the
+// engine against the original per-sample Reverb. Built with -Dbench=true and run with
+// `meson test --benchmark`.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "automation.hpp"
+#include "everb.hpp"
+
+namespace everb {
+namespace {
+
+constexpr double sampleRate = 48000.0;
+constexpr int blockSize     = 256;
+
+struct Result {
+    const char* tier;
+    bool network;
+    double nsPerFrame;
+    double msToDense; // first time the normalized echo density reaches denseEnough
+    double meanDensity;
+};
+
+// Normalized echo density (Abel and Huang): the fraction of a window's samples further
+// than one standard deviation from its mean, relative to the fraction for Gaussian noise.
+// 1 means the response is as dense as noise.
+constexpr int densityWindow     = 960; // 20 ms
+constexpr double denseEnough    = 0.9;
+constexpr double gaussianBeyond = 0.3173105078629141; // erfc (1 / sqrt (2))
+
+double echoDensity (const float* const response) {
+    double mean = 0, square = 0;
+    for (int i = 0; i < densityWindow; ++i) {
+        mean += response[i];
+        square += double (response[i]) * response[i];
+    }
+
+    mean /= densityWindow;
+    const double deviation = std::sqrt (std::max (0.0, square / densityWindow - mean * mean));
+    if (deviation <= 0)
+        return 0;
+
+    int beyond = 0;
+    for (int i = 0; i < densityWindow; ++i)
+        beyond += std::abs (response[i] - mean) > deviation ? 1 : 0;
+
+    return beyond / (gaussianBeyond * densityWindow);
+}
+
+ReverbParameters benchParameters (const bool network) {
+    ReverbParameters params;
+    params.roomSize = 0.8f;
+    params.wetLevel = 1.0f;
+    params.dryLevel = 0.0f;
+    params.network  = network ? 1.0f : 0.0f;
+    return params;
+}
+
+// The Reverb this engine grew out of, JUCE's FreeVerb port as it was: every comb and
+// all-pass runs per sample with a modulo and undenormalising, the stereo channels one after
+// the other. Kept as the baseline for what ReverbEngine gains.
+class OriginalReverb {
+public:
+    OriginalReverb() {
+        static const short combTunings[]    = { 1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617 }; // (at 44100Hz)
+        static const short allPassTunings[] = { 556, 441, 341, 225 };
+        const int stereoSpread              = 23;
+        const int intSampleRate             = (int) sampleRate;
+
+        for (int i = 0; i < numCombs; ++i) {
+            comb[0][i].setSize ((intSampleRate * combTunings[i]) / 44100);
+            comb[1][i].setSize ((intSampleRate * (combTunings[i] + stereoSpread)) / 44100);
+        }
+
+        for (int i = 0; i < numAllPasses; ++i) {
+            allPass[0][i].setSize ((intSampleRate * allPassTunings[i]) / 44100);
+            allPass[1][i].setSize ((intSampleRate * (allPassTunings[i] + stereoSpread)) / 44100);
+        }
+
+        for (auto* value : { &damping, &feedback, &dryGain, &wetGain1, &wetGain2 })
+            value->reset (sampleRate, 0.01);
+    }
+
+    void setParameters (const ReverbParameters& params) {
+        const float wet = params.wetLevel * 3.0f;
+        dryGain.setTargetValue (params.dryLevel * 2.0f);
+        wetGain1.setTargetValue (0.5f * wet * (1.0f + params.width));
+        wetGain2.setTargetValue (0.5f * wet * (1.0f - params.width));
+        gain = 0.015f;
+        damping.setTargetValue (params.damping * 0.4f);
+        feedback.setTargetValue (params.roomSize * 0.28f + 0.7f);
+    }
+
+    void processStereo (const float* const left, const float* const right, float* const out1, float* const out2, const int numSamples) noexcept {
+        for (int i = 0; i < numSamples; ++i) {
+            const float input = (left[i] + right[i]) * gain;
+            float outL = 0, outR = 0;
+
+            const float damp    = damping.getNextValue();
+            const float feedbck = feedback.getNextValue();
+
+            for (int j = 0; j < numCombs; ++j) { // accumulate the comb filters in parallel
+                outL += comb[0][j].process (input, damp, feedbck);
+                outR += comb[1][j].process (input, damp, feedbck);
+            }
+
+            for (int j = 0; j < numAllPasses; ++j) { // run the allpass filters in series
+                outL = allPass[0][j].process (outL);
+                outR = allPass[1][j].process (outR);
+            }
+
+            const float dry  = dryGain.getNextValue();
+            const float wet1 = wetGain1.getNextValue();
+            const float wet2 = wetGain2.getNextValue();
+
+            out1[i] = outL * wet1 + outR * wet2 + left[i] * dry;
+            out2[i] = outR * wet1 + outL * wet2 + right[i] * dry;
+        }
+    }
+
+private:
+    class CombFilter {
+    public:
+        void setSize (const int size) {
+            buffer.calloc ((size_t) size);
+            bufferSize = size;
+        }
+
+        float process (const float input, const float damp, const float feedbackLevel) noexcept {
+            const float output = buffer[bufferIndex];
+            last               = (output * (1.0f - damp)) + (last * damp);
+            JUCE_UNDENORMALISE (last);
+
+            float temp = input + (last * feedbackLevel);
+            JUCE_UNDENORMALISE (temp);
+            buffer[bufferIndex] = temp;
+            bufferIndex         = (bufferIndex + 1) % bufferSize;
+            return output;
+        }
+
+    private:
+        juce::HeapBlock<float> buffer;
+        int bufferSize = 0, bufferIndex = 0;
+        float last = 0.0f;
+    };
+
+    class AllPassFilter {
+    public:
+        void setSize (const int size) {
+            buffer.calloc ((size_t) size);
+            bufferSize = size;
+        }
+
+        float process (const float input) noexcept {
+            const float bufferedValue = buffer[bufferIndex];
+            float temp                = input + (bufferedValue * 0.5f);
+            JUCE_UNDENORMALISE (temp);
+            buffer[bufferIndex] = temp;
+            bufferIndex         = (bufferIndex + 1) % bufferSize;
+            return bufferedValue - input;
+        }
+
+    private:
+        juce::HeapBlock<float> buffer;
+        int bufferSize = 0, bufferIndex = 0;
+    };
+
+    enum { numCombs = 8, numAllPasses = 4 };
+
+    float gain = 0.015f;
+    CombFilter comb[2][numCombs];
+    AllPassFilter allPass[2][numAllPasses];
+    juce::SmoothedValue<float> damping, feedback, dryGain, wetGain1, wetGain2;
+};
+
+// Nanoseconds per frame of processBlock (blockNumber), after a warm up.
+template <typename ProcessBlock>
+double timePerFrame (ProcessBlock&& processBlock) {
+    constexpr int warmUpBlocks = 400, timedBlocks = 8000;
+    int blockNumber            = 0;
+    for (int b = 0; b < warmUpBlocks; ++b)
+        processBlock (blockNumber++);
+
+    // Best of a few runs, to keep other load on the machine out of the figure.
+    double best = 0;
+    for (int run = 0; run < 5; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        for (int b = 0; b < timedBlocks; ++b)
+            processBlock (blockNumber++);
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+        const double perFrame = elapsed.count() / (double (timedBlocks) * blockSize);
+        best                  = run == 0 ? perFrame : std::min (best, perFrame);
+    }
+
+    return best;
+}
+
+std::vector<float> noiseBlock (const unsigned seed) {
+    std::vector<float> block (blockSize);
+    std::mt19937 random (seed);
+    std::uniform_real_distribution<float> noise (-0.5f, 0.5f);
+    for (auto& sample : block)
+        sample = noise (random);
+    return block;
+}
+
+template <typename Engine>
+void prepareEngine (Engine& engine) {
+    engine.setKernels (Engine::KernelTable::best());
+    engine.prepare (sampleRate, blockSize);
+}
+
+void prepareEngine (OriginalReverb&) {}
+
+template <typename Engine>
+size_t memoryOf() {
+    auto engine = std::make_unique<Engine>();
+    prepareEngine (*engine);
+    return engine->getMemoryUsage();
+}
+
+template <typename Engine>
+double measureCost (const bool network) {
+    auto engine = std::make_unique<Engine>();
+    prepareEngine (*engine);
+    engine->setParameters (benchParameters (network));
+
+    auto left = noiseBlock (1), right = noiseBlock (2);
+    std::vector<float> outL (blockSize), outR (blockSize);
+
+    return timePerFrame ([&] (int) {
+        engine->processStereo (left.data(), right.data(), outL.data(), outR.data(), blockSize);
+    });
+}
+
+// The cost with eventsPerBlock parameter events spread evenly over each block, applied
+// through renderAutomated() as the CLAP plugin does in real time or offline. The events sweep the room size up and
+// down over a second, so every block has the engine smoothing towards a new feedback. The
+// sweep is worked out beforehand to leave its cost out.
+template <typename Engine>
+double measureAutomation (const int eventsPerBlock, const int granularity) {
+    auto engine = std::make_unique<Engine>();
+    engine->setKernels (Engine::KernelTable::best());
+    engine->prepare (sampleRate, blockSize);
+
+    auto params = benchParameters (false);
+    engine->setParameters (params);
+
+    auto left = noiseBlock (1), right = noiseBlock (2);
+    std::vector<float> outL (blockSize), outR (blockSize);
+
+    const auto timeOf     = [eventsPerBlock] (int i) { return i * blockSize / eventsPerBlock; };
+    const int sweepBlocks = int (sampleRate) / blockSize;
+    std::vector<float> sweep (size_t (sweepBlocks) * eventsPerBlock);
+    for (int b = 0; b < sweepBlocks; ++b)
+        for (int i = 0; i < eventsPerBlock; ++i)
+            sweep[size_t (b) * eventsPerBlock + i] = float (0.5 + 0.3 * std::sin (juce::MathConstants<double>::twoPi * (b * blockSize + timeOf (i)) / sampleRate));
+
+    return timePerFrame ([&] (int block) {
+        const float* const values = sweep.data() + size_t (block % sweepBlocks) * eventsPerBlock;
+
+        bool changed = false;
+        renderAutomated (
+            blockSize,
+            eventsPerBlock,
+            timeOf,
+            [&] (int i) {
+                params.roomSize = values[i];
+                changed         = true;
+            },
+            [&] (int start, int num) {
+                if (changed)
+                    engine->setParameters (params);
+                changed = false;
+
+                engine->processStereo (left.data() + start, right.data() + start, outL.data() + start, outR.data() + start, num);
+            },
+            granularity);
+    });
+}
+
+template <typename Engine>
+void measureDensity (const bool network, Result& result) {
+    auto engine = std::make_unique<Engine>();
+    engine->prepare (sampleRate, blockSize);
+    engine->setParameters (benchParameters (network));
+
+    // Skip the gain ramps from the default parameters, then take the impulse response.
+    std::vector<float> left (blockSize), right (blockSize);
+    for (int b = 0; b < 64; ++b)
+        engine->processStereo (left.data(), right.data(), left.data(), right.data(), blockSize);
+    engine->reset();
+
+    const int length = int (sampleRate / 2);
+    std::vector<float> response (length);
+    for (int done = 0; done < length; done += blockSize) {
+        const int num = std::min (blockSize, length - done);
+        std::fill (left.begin(), left.end(), 0.0f);
+        std::fill (right.begin(), right.end(), 0.0f);
+        if (done == 0)
+            left[0] = right[0] = 1.0f;
+
+        engine->processStereo (left.data(), right.data(), left.data(), right.data(), num);
+        std::copy_n (left.data(), num, response.data() + done);
+    }
+
+    constexpr int hop = densityWindow / 4;
+    double total      = 0;
+    int numWindows    = 0;
+    result.msToDense  = -1;
+
+    for (int start = 0; start + densityWindow <= length; start += hop, ++numWindows) {
+        const double density = echoDensity (response.data() + start);
+        total += density;
+
+        if (result.msToDense < 0 && density >= denseEnough)
+            result.msToDense = 1000.0 * (start + densityWindow) / sampleRate;
+    }
+
+    result.meanDensity = total / numWindows;
+}
+
+template <typename Engine>
+Result measure (const char* const tier, const bool network) {
+    Result result { tier, network, measureCost<Engine> (network), 0, 0 };
+    measureDensity<Engine> (network, result);
+    return result;
+}
+
+} // namespace
+} // namespace everb
+
+int main() {
+    using namespace everb;
+    juce::ScopedNoDenormals noDenormals;
+
+    std::printf ("eVerb tank benchmark, stereo at %.0f Hz, %s kernels\n\n",
+                 sampleRate,
+                 TieredReverb<2>::Standard::KernelTable::best().name);
+
+    std::vector<Result> results;
+    for (const bool network : { false, true }) {
+        results.push_back (measure<TieredReverb<2>::Eco> ("eco", network));
+        results.push_back (measure<TieredReverb<2>::Standard> ("standard", network));
+        results.push_back (measure<TieredReverb<2>::Dense> ("dense", network));
+    }
+
+    std::printf ("%-9s %-9s %10s %14s %13s\n", "engine", "tier", "ns/frame", "ms to NED 0.9", "mean NED");
+    for (const auto& r : results) {
+        char dense[32] = "never";
+        if (r.msToDense >= 0)
+            std::snprintf (dense, sizeof (dense), "%.0f", r.msToDense);
+
+        std::printf ("%-9s %-9s %10.1f %14s %13.3f\n",
+                     r.network ? "network" : "combs", r.tier, r.nsPerFrame, dense, r.meanDensity);
+    }
+
+    // At equal density: for each comb tier, the cheapest network tier that gets as dense
+    // at least as soon.
+    std::printf ("\n");
+    for (const auto& combs : results) {
+        if (combs.network || combs.msToDense < 0)
+            continue;
+
+        const Result* cheapest = nullptr;
+        for (const auto& network : results)
+            if (network.network && network.msToDense >= 0 && network.msToDense <= combs.msToDense)
+                if (cheapest == nullptr || network.nsPerFrame < cheapest->nsPerFrame)
+                    cheapest = &network;
+
+        if (cheapest == nullptr)
+            std::printf ("combs %-9s no network tier is as dense\n", combs.tier);
+        else
+            std::printf ("combs %-9s matched by network %-9s at %.2fx the cost\n",
+                         combs.tier, cheapest->tier, cheapest->nsPerFrame / combs.nsPerFrame);
+    }
+
+    // The engine against the per-sample Reverb it replaced, at the same topology.
+    const double original = measureCost<OriginalReverb> (false);
+    const double engine   = measureCost<ReverbEngine<8, 4, 2, float>> (false);
+    std::printf ("\nReverbEngine<8, 4, 2, float> against the original Reverb:\n");
+    std::printf ("%-24s %10.1f\n", "original", original);
+    std::printf ("%-24s %10.1f  %.2fx faster\n", "ReverbEngine", engine, original / engine);
+
+    // Half precision delay lines, at half the memory.
+    const double compact = measureCost<ReverbCompact> (false);
+    std::printf ("%-24s %10.1f  %.2fx the float cost, %zu against %zu bytes\n", "ReverbCompact (half)", compact, compact / engine,
+                 memoryOf<ReverbCompact>(), memoryOf<Reverb>());
+
+    // Sample accurate automation, against the same engine left alone.
+    using Automated = TieredReverb<2>::Standard;
+
+    const double unmoved = measureCost<Automated> (false);
+    std::printf ("\nautomation, standard combs, %d frame blocks:\n", blockSize);
+    std::printf ("%-24s %10.1f\n", "static", unmoved);
+    for (const int events : { 1, 16, 1000 }) {
+        const double automated = measureAutomation<Automated> (events, automationGranularity);
+        std::printf ("%4d events/block        %10.1f  %.2fx\n", events, automated, automated / unmoved);
+    }
+
+    for (const int events : { 16, 1000 }) {
+        const double offline = measureAutomation<Automated> (events, offlineAutomationGranularity);
+        std::printf ("%4d events/block, offline %8.1f  %.2fx\n", events, offline, offline / unmoved);
+    }
+
+    return 0;
+}
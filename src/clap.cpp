@@ -1,21 +1,314 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <cstring>
 #include <memory>
+#include <string>
 
 #include <clap/clap.h>
 #include <lui/cairo.hpp>
 
+#include "automation.hpp"
 #include "content.hpp"
 #include "everb.hpp"
 #include "ports.hpp"
 
 namespace everb {
 
+/** The reverb for the selected audio port configuration, behind one interface whatever its
+    channel count.
+*/
+struct Engine {
+    virtual ~Engine() = default;
+
+    virtual void set_kernels() = 0;
+    virtual const char* kernel_name() const = 0;
+    virtual void set_min_tank_rate (double rate) = 0;
+    virtual void set_task_pool (TaskPool* pool, int min_frames) = 0;
+    virtual void prepare (double sample_rate, int max_frames) = 0;
+    virtual int latency() const = 0;
+    virtual uint32_t tail() const = 0;
+    virtual void set_parameters (const Reverb::Parameters& params) = 0;
+    virtual void reset() = 0;
+
+    /** Renders frames of the process' buffers from start. Returns true if the tail had died
+        away and silence in gave silence out, without running the tank.
+    */
+    virtual bool process (const clap_process_t* process, uint32_t start, uint32_t frames) = 0;
+};
+
+/** The most input ports of any configuration. */
+static constexpr uint32_t max_input_ports = 32;
+
+// Mono and stereo follow the quality parameter, surround beds run the standard tier.
+template <int num_channels>
+struct EngineFor final : public Engine {
+    static constexpr bool is_tiered = num_channels <= 2;
+
+    void set_kernels() override {
+        if constexpr (is_tiered)
+            reverb.useBestKernels();
+        else
+            reverb.setKernels (PluginEngine<num_channels>::KernelTable::best());
+    }
+
+    const char* kernel_name() const override {
+        if constexpr (is_tiered)
+            return reverb.getKernelName();
+        else
+            return reverb.getKernels().name;
+    }
+
+    void set_min_tank_rate (double rate) override { reverb.setMinTankRate (rate); }
+    void set_task_pool (TaskPool* pool, int min_frames) override { reverb.setTaskPool (pool, min_frames); }
+    void prepare (double sample_rate, int max_frames) override { reverb.prepare (sample_rate, max_frames); }
+    int latency() const override { return reverb.getLatencySamples(); }
+
+    uint32_t tail() const override {
+        const int samples = reverb.getTailSamples();
+        return samples < 0 ? static_cast<uint32_t> (INT32_MAX) : static_cast<uint32_t> (samples);
+    }
+
+    void set_parameters (const Reverb::Parameters& params) override { reverb.setParameters (params); }
+    void reset() override { reverb.reset(); }
+
+    bool process (const clap_process_t* process, uint32_t start, uint32_t frames) override {
+        // 64-bit hosts hand over double buffers, which the engine takes as they are.
+        bool is_64 = process->audio_outputs[0].data64 != nullptr;
+        for (uint32_t p = 0; p < process->audio_inputs_count; ++p)
+            is_64 = is_64 && process->audio_inputs[p].data64 != nullptr;
+
+        return is_64 ? run<double> (process, start, static_cast<int> (frames))
+                     : run<float> (process, start, static_cast<int> (frames));
+    }
+
+private:
+    std::conditional_t<is_tiered, PluginTieredReverb<num_channels>, PluginEngine<num_channels>> reverb;
+
+    template <typename T>
+    static T** buffers (const clap_audio_buffer_t& buffer) noexcept {
+        if constexpr (std::is_same_v<T, double>)
+            return buffer.data64;
+        else
+            return buffer.data32;
+    }
+
+    // True if every input channel is silent over the run, trusting the host's constant_mask
+    // where set.
+    template <typename T>
+    static bool is_silent (const clap_process_t* process, uint32_t start, int frames) noexcept {
+        for (uint32_t p = 0; p < process->audio_inputs_count; ++p) {
+            const auto& port = process->audio_inputs[p];
+            T** const data   = buffers<T> (port);
+
+            for (uint32_t c = 0; c < port.channel_count; ++c) {
+                const bool constant = c < 64 && (port.constant_mask & (uint64_t (1) << c)) != 0;
+                const T* const run  = data[c] + start;
+                if (! isSilence (&run, 1, constant ? juce::jmin (1, frames) : frames))
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+    template <typename T>
+    bool run (const clap_process_t* process, uint32_t start, int frames) noexcept {
+        const auto& input  = process->audio_inputs[0];
+        const auto& output = process->audio_outputs[0];
+
+        T* ins[num_channels];
+        T* outs[num_channels];
+        for (uint32_t c = 0; c < juce::jmin (input.channel_count, uint32_t (num_channels)); ++c)
+            ins[c] = buffers<T> (input)[c] + start;
+        for (uint32_t c = 0; c < juce::jmin (output.channel_count, uint32_t (num_channels)); ++c)
+            outs[c] = buffers<T> (output)[c] + start;
+
+        // Once the tail has died away silence in gives silence out: skip the tank and let
+        // the host know the outputs are constant.
+        if (reverb.isTailSilent() && is_silent<T> (process, start, frames)) {
+            reverb.skipSilence (frames);
+            for (uint32_t c = 0; c < output.channel_count; ++c)
+                std::fill_n (outs[c], frames, T());
+            return true;
+        }
+
+        if constexpr (num_channels == 1) {
+            reverb.processMono (ins[0], outs[0], frames);
+        } else if constexpr (num_channels == 2) {
+            if (process->audio_inputs[0].channel_count == 1) {
+                reverb.processStereo (ins[0], ins[0], outs[0], outs[1], frames);
+            } else if (process->audio_inputs_count > 1) {
+                // Send bus: only the main input keeps its dry path.
+                const T* left[max_input_ports];
+                const T* right[max_input_ports];
+                bool has_dry[max_input_ports];
+                const auto num_inputs = std::min (process->audio_inputs_count, max_input_ports);
+
+                for (uint32_t p = 0; p < num_inputs; ++p) {
+                    T** const send = buffers<T> (process->audio_inputs[p]);
+                    left[p]        = send[0] + start;
+                    right[p]       = send[1] + start;
+                    has_dry[p]     = p == 0;
+                }
+
+                reverb.processBus (left, right, has_dry, (int) num_inputs, outs[0], outs[1], frames);
+            } else {
+                reverb.processStereo (ins[0], ins[1], outs[0], outs[1], frames);
+            }
+        } else {
+            reverb.processChannels (ins, outs, frames);
+        }
+
+        return false;
+    }
+};
+
+/** An audio port configuration: a main input and a main output, and for a send bus more
+    inputs like the main one after it.
+*/
+struct PortConfig {
+    clap_id id;
+    const char* name;
+    uint32_t input_channels, output_channels;
+    uint32_t input_port_count;
+    uint8_t channel_map[12]; // CLAP_SURROUND_* positions, for surround ports
+    std::unique_ptr<Engine> (*create)();
+
+    static const char* port_type (uint32_t channels) noexcept {
+        return channels == 1 ? CLAP_PORT_MONO : (channels == 2 ? CLAP_PORT_STEREO : CLAP_PORT_SURROUND);
+    }
+
+    bool is_surround() const noexcept { return output_channels > 2; }
+
+    uint64_t channel_mask() const noexcept {
+        uint64_t mask = 0;
+        for (uint32_t c = 0; c < output_channels; ++c)
+            mask |= uint64_t (1) << channel_map[c];
+        return mask;
+    }
+};
+
+template <int num_channels>
+static std::unique_ptr<Engine> create_engine() {
+    return std::make_unique<EngineFor<num_channels>>();
+}
+
+// Every channel of a surround bed gets its own tank, all fed the same sum of the inputs,
+// so one instance replaces a stereo one per channel pair.
+//
+// The send buses sum every input into one stereo tank, so tracks sharing a room cost one
+// reverb rather than one each. Only the main input keeps its dry path, the sends are wet.
+//
+// Mono runs a single channel engine at half the cost of stereo. Mono to stereo feeds the
+// one input to both sides of the stereo engine, as hosts do putting a mono track through a
+// stereo plugin.
+static const PortConfig port_configs[] = {
+    { 0, "Stereo", 2, 2, 1, { CLAP_SURROUND_FL, CLAP_SURROUND_FR }, &create_engine<2> },
+    { 1, "Quad", 4, 4, 1, { CLAP_SURROUND_FL, CLAP_SURROUND_FR, CLAP_SURROUND_BL, CLAP_SURROUND_BR }, &create_engine<4> },
+    { 2, "5.1", 6, 6, 1, { CLAP_SURROUND_FL, CLAP_SURROUND_FR, CLAP_SURROUND_FC, CLAP_SURROUND_LFE, CLAP_SURROUND_BL, CLAP_SURROUND_BR }, &create_engine<6> },
+    { 3, "7.1", 8, 8, 1, { CLAP_SURROUND_FL, CLAP_SURROUND_FR, CLAP_SURROUND_FC, CLAP_SURROUND_LFE, CLAP_SURROUND_BL, CLAP_SURROUND_BR, CLAP_SURROUND_SL, CLAP_SURROUND_SR }, &create_engine<8> },
+    { 4, "7.1.4", 12, 12, 1, { CLAP_SURROUND_FL, CLAP_SURROUND_FR, CLAP_SURROUND_FC, CLAP_SURROUND_LFE, CLAP_SURROUND_BL, CLAP_SURROUND_BR, CLAP_SURROUND_SL, CLAP_SURROUND_SR, CLAP_SURROUND_TFL, CLAP_SURROUND_TFR, CLAP_SURROUND_TBL, CLAP_SURROUND_TBR }, &create_engine<12> },
+    { 5, "Send Bus, 4 Inputs", 2, 2, 4, { CLAP_SURROUND_FL, CLAP_SURROUND_FR }, &create_engine<2> },
+    { 6, "Send Bus, 8 Inputs", 2, 2, 8, { CLAP_SURROUND_FL, CLAP_SURROUND_FR }, &create_engine<2> },
+    { 7, "Send Bus, 16 Inputs", 2, 2, 16, { CLAP_SURROUND_FL, CLAP_SURROUND_FR }, &create_engine<2> },
+    { 8, "Send Bus, 32 Inputs", 2, 2, max_input_ports, { CLAP_SURROUND_FL, CLAP_SURROUND_FR }, &create_engine<2> },
+    { 9, "Mono", 1, 1, 1, { CLAP_SURROUND_FC }, &create_engine<1> },
+    { 10, "Mono to Stereo", 1, 2, 1, { CLAP_SURROUND_FL, CLAP_SURROUND_FR }, &create_engine<2> }
+};
+
+static constexpr uint32_t num_port_configs = sizeof (port_configs) / sizeof (port_configs[0]);
+
+/** The lowest rate the Reduced Rate parameter lets the tank run at: 96 and 192 kHz sessions
+    get a 48 kHz tank, 88.2 and 176.4 kHz ones a 44.1 kHz tank.
+*/
+static constexpr double reduced_tank_rate = 44100.0;
+
+/** The shortest runs the two halves of the tank are split across the host's thread pool
+    for. The standard stereo tank takes around 30 us for 1024 frames; for much less than that
+    waking a pool thread costs more than it saves and only adds to the audio thread's
+    deadline. Offline there is no deadline, just the time to wake it.
+*/
+static constexpr int parallel_frames         = 1024;
+static constexpr int offline_parallel_frames = 512;
+
+/** The host's thread pool as the engine sees it. run() is only called from process(), as
+    clap_host_thread_pool::request_exec requires, and the host calls exec() back for each task.
+*/
+struct HostTaskPool final : public TaskPool {
+    const clap_host_t* host { nullptr };
+    const clap_host_thread_pool_t* pool { nullptr };
+
+    Task task { nullptr };
+    void* context { nullptr };
+
+    bool run (Task new_task, void* new_context, int num_tasks) noexcept override {
+        task    = new_task;
+        context = new_context;
+        return pool->request_exec (host, static_cast<uint32_t> (num_tasks));
+    }
+
+    void exec (uint32_t task_index) noexcept { task (context, static_cast<int> (task_index)); }
+};
+
+/** Parameter values shared by the main and audio threads without locking.
+
+    Each value is published by storing it and then setting its bit in a mask the other side
+    drains with an exchange, so neither thread ever waits on the other. The main thread
+    publishes the gui and state changes for the audio thread to apply, and the audio thread
+    the host's automation for the gui to show. The values are also what the host reads back.
+*/
+struct alignas (64) SharedParams {
+    static constexpr uint32_t count = Ports::ReducedRate - Ports::Wet + 1;
+    static_assert (count <= 32, "one bit per parameter");
+
+    static constexpr uint32_t bit (clap_id param_id) noexcept { return uint32_t (1) << (param_id - Ports::Wet); }
+
+    std::atomic<float> values[count];
+    std::atomic<uint32_t> pending { 0 }; // set on the main thread for the engine to apply
+    std::atomic<uint32_t> to_host { 0 }; // of the pending ones, those to send the host as events
+    std::atomic<uint32_t> to_gui { 0 };  // set on the audio thread for the sliders to follow
+
+    float get (clap_id param_id) const noexcept { return values[param_id - Ports::Wet].load (std::memory_order_relaxed); }
+
+    void set (clap_id param_id, double value) noexcept {
+        values[param_id - Ports::Wet].store (static_cast<float> (value), std::memory_order_relaxed);
+    }
+};
+
 struct eVerb {
     clap_plugin_t plugin;
-    Reverb reverb;
+
+    // Main thread to audio thread, on cache lines of their own: the gui writes here while
+    // the audio thread runs the engine below.
+    SharedParams shared;
+
+    // Set by the host's render extension. Offline, throughput matters more than timing.
+    std::atomic<bool> offline { false };
+
+    // Owned by the audio thread while active and by the main thread otherwise. The
+    // parameters the engine runs with, which trail shared until the pending ones are applied,
+    // and the host's modulation on top of them.
+    alignas (64) std::unique_ptr<Engine> reverb;
     Reverb::Parameters params;
+    float modulation[SharedParams::count] {};
+    uint32_t modulated { 0 };
+
+    // The tank rate only changes on activation, so does the latency it brings.
+    bool reduced_rate { false }, restart_pending { false };
 
-    mutable std::mutex params_mutex;
+    // The tail follows the feedback, worked out again once per block after the parameters
+    // change. The audio thread tells the host it changed.
+    bool tail_stale { false };
+    std::atomic<uint32_t> tail { 0 };
+
+    // The engine runs stereo and surround tanks a half per thread on the host's pool, if it
+    // has one, for runs of at least parallel_frames, or offline_parallel_frames offline.
+    HostTaskPool tasks;
+    bool pool_offline { false };
+
+    alignas (64) const PortConfig* config { nullptr };
+    uint32_t latency { 0 };
 
     std::vector<clap_audio_port_info_t> ins, outs;
     std::vector<clap_param_info_t> param_info;
@@ -25,9 +318,19 @@ struct eVerb {
 
     const clap_host_t* host { nullptr };
     const clap_host_timer_support_t* timer { nullptr };
+    const clap_host_log_t* log { nullptr };
+    const clap_host_latency_t* host_latency { nullptr };
+    const clap_host_tail_t* host_tail { nullptr };
+    const clap_host_params_t* host_params { nullptr };
     clap_id idle_timer { CLAP_INVALID_ID };
 
-    double get_param (uint32_t param_id, const Reverb::Parameters& values) {
+    void use_task_pool (bool is_offline) {
+        pool_offline = is_offline;
+        reverb->set_task_pool (tasks.pool != nullptr ? &tasks : nullptr,
+                               is_offline ? offline_parallel_frames : parallel_frames);
+    }
+
+    static double get_param (uint32_t param_id, const Reverb::Parameters& values) {
         switch (param_id) {
             case Ports::Damping:
                 return values.damping;
@@ -44,56 +347,234 @@ struct eVerb {
             case Ports::Width:
                 return values.width;
                 break;
+            case Ports::Quality:
+                return values.quality;
+                break;
+            case Ports::Network:
+                return values.network;
+                break;
+            case Ports::Size:
+                return values.size;
+                break;
+            case Ports::ReducedRate:
+                return values.reducedRate;
+                break;
         }
 
         return 0.0;
     }
 
+    static void set_param (Reverb::Parameters& values, clap_id param_id, double value) noexcept {
+        switch (param_id) {
+            case Ports::Damping:
+                values.damping = static_cast<float> (value);
+                break;
+            case Ports::Dry:
+                values.dryLevel = static_cast<float> (value);
+                break;
+            case Ports::RoomSize:
+                values.roomSize = static_cast<float> (value);
+                break;
+            case Ports::Wet:
+                values.wetLevel = static_cast<float> (value);
+                break;
+            case Ports::Width:
+                values.width = static_cast<float> (value);
+                break;
+            case Ports::Quality:
+                values.quality = static_cast<float> (value);
+                break;
+            case Ports::Network:
+                values.network = static_cast<float> (value);
+                break;
+            case Ports::Size:
+                values.size = static_cast<float> (value);
+                break;
+            case Ports::ReducedRate:
+                values.reducedRate = static_cast<float> (value);
+                break;
+        }
+    }
+
     void sync_params() {
         if (content == nullptr)
             return;
 
-        const auto sp = safe_params();
         for (uint32_t port = Ports::paramsBegin(); port < Ports::paramsEnd(); ++port) {
-            content->update_slider (port, get_param (port, sp));
+            content->update_slider (port, shared.get (port));
         }
     }
 
+    // Moves the sliders the host has automated since last time.
+    // [main-thread]
+    void sync_automation() {
+        auto changed = shared.to_gui.exchange (0, std::memory_order_acquire);
+        if (content == nullptr)
+            return;
+
+        for (uint32_t port = Ports::paramsBegin(); changed != 0 && port < Ports::paramsEnd(); ++port)
+            if ((changed & SharedParams::bit (port)) != 0)
+                content->update_slider (port, shared.get (port));
+    }
+
+    // The parameters as last published, whether or not the engine has them yet.
     Reverb::Parameters safe_params() const noexcept {
         Reverb::Parameters out_params;
-        {
-            std::lock_guard<std::mutex> sl (params_mutex);
-            out_params = params;
-        }
+        for (clap_id id = Ports::Wet; id <= Ports::ReducedRate; ++id)
+            set_param (out_params, id, shared.get (id));
         return out_params;
     }
 
-    void update (clap_id param_id, double value) noexcept {
-        switch (param_id) {
-            case Ports::Damping:
-                params.damping = static_cast<float> (value);
-                break;
-            case Ports::Dry:
-                params.dryLevel = static_cast<float> (value);
-                break;
-            case Ports::RoomSize:
-                params.roomSize = static_cast<float> (value);
-                break;
-            case Ports::Wet:
-                params.wetLevel = static_cast<float> (value);
-                break;
-            case Ports::Width:
-                params.width = static_cast<float> (value);
-                break;
+    // Publishes a value for the engine, and for the host too when the user made the change.
+    // [main-thread]
+    void post (clap_id param_id, double value, bool from_gui) noexcept {
+        shared.set (param_id, value);
+        if (from_gui)
+            shared.to_host.fetch_or (SharedParams::bit (param_id), std::memory_order_relaxed);
+        shared.pending.fetch_or (SharedParams::bit (param_id), std::memory_order_release);
+    }
+
+    // Asks the host to pick up posted values, via process() when active or a flush otherwise.
+    // [main-thread]
+    void request_flush() noexcept {
+        if (host_params != nullptr)
+            host_params->request_flush (host);
+        else
+            host->request_process (host);
+    }
+
+    // True for the parameters the host may modulate: the continuous ones.
+    static bool is_modulatable (clap_id param_id) noexcept {
+        return param_id != Ports::Quality && param_id != Ports::Network && param_id != Ports::ReducedRate;
+    }
+
+    // Takes one of the host's events, returning true if it changed a parameter. Automated
+    // values are marked in automated for the gui to follow.
+    // [active ? audio-thread : main-thread]
+    bool take_event (const clap_event_header_t* ev, uint32_t& automated) noexcept {
+        if (ev->space_id != CLAP_CORE_EVENT_SPACE_ID)
+            return false;
+
+        switch (ev->type) {
+            case CLAP_EVENT_PARAM_VALUE: {
+                auto pv = (const clap_event_param_value_t*) ev;
+                if (pv->param_id < Ports::Wet || pv->param_id > Ports::ReducedRate)
+                    return false;
+
+                set_param (params, pv->param_id, pv->value);
+                shared.set (pv->param_id, pv->value);
+                automated |= SharedParams::bit (pv->param_id);
+                return true;
+            }
+
+            case CLAP_EVENT_PARAM_MOD: {
+                // Only global modulation, eVerb has no voices to modulate per note.
+                auto pm = (const clap_event_param_mod_t*) ev;
+                if (pm->param_id < Ports::Wet || pm->param_id > Ports::ReducedRate
+                    || ! is_modulatable (pm->param_id) || pm->note_id >= 0)
+                    return false;
+
+                const auto amount                      = static_cast<float> (pm->amount);
+                modulation[pm->param_id - Ports::Wet] = amount;
+                if (amount != 0.0f)
+                    modulated |= SharedParams::bit (pm->param_id);
+                else
+                    modulated &= ~SharedParams::bit (pm->param_id);
+                return true;
+            }
         }
+
+        return false;
+    }
+
+    // Takes the values posted from the main thread, sending the host an event for each change
+    // the user made in the gui. Returns true if there were any.
+    // [active ? audio-thread : main-thread]
+    bool take_posted (const clap_output_events_t* out) noexcept {
+        if (shared.pending.load (std::memory_order_relaxed) == 0)
+            return false;
+
+        const auto posted  = shared.pending.exchange (0, std::memory_order_acquire);
+        const auto to_host = shared.to_host.fetch_and (~posted, std::memory_order_relaxed) & posted;
+
+        for (clap_id id = Ports::Wet; id <= Ports::ReducedRate; ++id) {
+            if ((posted & SharedParams::bit (id)) == 0)
+                continue;
+
+            const double value = shared.get (id);
+            set_param (params, id, value);
+
+            if (out == nullptr || (to_host & SharedParams::bit (id)) == 0)
+                continue;
+
+            clap_event_param_value_t ev;
+            ev.header.size     = sizeof (ev);
+            ev.header.time     = 0;
+            ev.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+            ev.header.type     = CLAP_EVENT_PARAM_VALUE;
+            ev.header.flags    = 0;
+            ev.param_id        = id;
+            ev.cookie          = nullptr;
+            ev.note_id         = -1;
+            ev.port_index      = -1;
+            ev.channel         = -1;
+            ev.key             = -1;
+            ev.value           = value;
+            out->try_push (out, &ev.header);
+        }
+
+        return true;
+    }
+
+    // Lets the gui follow the automation and the host the tail, once per block.
+    // [active ? audio-thread : main-thread]
+    void notify (uint32_t automated) noexcept {
+        if (automated != 0)
+            shared.to_gui.fetch_or (automated, std::memory_order_release);
+
+        if (! tail_stale)
+            return;
+
+        tail_stale          = false;
+        const auto new_tail = reverb->tail();
+        if (new_tail != tail.exchange (new_tail, std::memory_order_relaxed) && host_tail != nullptr)
+            host_tail->changed (host);
+    }
+
+    // Takes all of the host's events and the posted values into the engine at once, for a
+    // flush outside of process().
+    // [active ? audio-thread : main-thread]
+    void receive (const clap_input_events_t* in, const clap_output_events_t* out) noexcept {
+        uint32_t automated = 0;
+        bool param_changed = take_posted (out);
+
+        const auto num_in = in != nullptr ? in->size (in) : 0;
+        for (uint32_t i = 0; i < num_in; ++i)
+            param_changed = take_event (in->get (in, i), automated) || param_changed;
+
+        if (param_changed)
+            apply_params();
+
+        notify (automated);
     }
 
-    void update (const clap_event_param_value_t* value) noexcept {
-        update (value->param_id, value->value);
+    // The parameters with the host's modulation added, as the engine runs them.
+    Reverb::Parameters modulated_params() const noexcept {
+        auto values = params;
+        for (clap_id id = Ports::Wet; modulated != 0 && id <= Ports::ReducedRate; ++id)
+            if ((modulated & SharedParams::bit (id)) != 0)
+                set_param (values, id, juce::jlimit (0.0, 1.0, get_param (id, params) + modulation[id - Ports::Wet]));
+        return values;
     }
 
     void apply_params() {
-        reverb.setParameters (params);
+        reverb->set_parameters (modulated_params());
+        tail_stale = true;
+
+        if ((params.reducedRate >= 0.5f) != reduced_rate && ! restart_pending) {
+            host->request_restart (host);
+            restart_pending = true;
+        }
     }
 };
 
@@ -108,6 +589,39 @@ inline static void copy_name (char* dst, const char* src) {
     dst[name.getNumBytesAsUTF8()] = '\0';
 }
 
+// Switches to a port configuration, with a new engine for its channel count.
+// [main-thread & !active]
+inline static void select (eVerb& self, const PortConfig& config) {
+    self.config = &config;
+    self.reverb = config.create();
+    self.reverb->set_parameters (self.safe_params());
+    self.reverb->reset();
+
+    clap_audio_port_info_t info;
+    info.flags         = CLAP_AUDIO_PORT_SUPPORTS_64BITS;
+    info.id            = 0;
+    info.in_place_pair = CLAP_INVALID_ID;
+    info.channel_count = config.input_channels;
+    info.port_type     = PortConfig::port_type (config.input_channels);
+
+    self.ins.clear();
+    self.outs.clear();
+    copy_name (info.name, "Input");
+    self.ins.push_back (info);
+
+    for (uint32_t p = 1; p < config.input_port_count; ++p) {
+        info.id = p;
+        copy_name (info.name, ("Send " + std::to_string (p)).c_str());
+        self.ins.push_back (info);
+    }
+
+    info.id            = 0;
+    info.channel_count = config.output_channels;
+    info.port_type     = PortConfig::port_type (config.output_channels);
+    copy_name (info.name, "Output");
+    self.outs.push_back (info);
+}
+
 } // namespace detail
 
 static const clap_plugin_audio_ports_t _audio_ports = {
@@ -132,6 +646,118 @@ static const clap_plugin_audio_ports_t _audio_ports = {
     }
 };
 
+//==============================================================================
+static const clap_plugin_audio_ports_config_t _audio_ports_config = {
+    // Gets the number of available configurations
+    // [main-thread]
+    .count = [] (const clap_plugin_t*) -> uint32_t {
+        return num_port_configs;
+    },
+
+    // Gets information about a configuration
+    // Returns true on success and stores the result into config.
+    // [main-thread]
+    .get = [] (const clap_plugin_t*, uint32_t index, clap_audio_ports_config_t* config) -> bool {
+        if (index >= num_port_configs)
+            return false;
+
+        const auto& pc = port_configs[index];
+        config->id     = pc.id;
+        detail::copy_name (config->name, pc.name);
+        config->input_port_count          = pc.input_port_count;
+        config->output_port_count         = 1;
+        config->has_main_input            = true;
+        config->main_input_channel_count  = pc.input_channels;
+        config->main_input_port_type      = PortConfig::port_type (pc.input_channels);
+        config->has_main_output           = true;
+        config->main_output_channel_count = pc.output_channels;
+        config->main_output_port_type     = PortConfig::port_type (pc.output_channels);
+        return true;
+    },
+
+    // Selects the configuration designated by id
+    // Returns true if the configuration could be applied.
+    // Once applied the host should scan again the audio ports.
+    // [main-thread & plugin-deactivated]
+    .select = [] (const clap_plugin_t* plugin, clap_id config_id) -> bool {
+        for (const auto& pc : port_configs) {
+            if (pc.id == config_id) {
+                detail::select (detail::from (plugin), pc);
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+static const clap_plugin_latency_t _latency = {
+    // Returns the plugin latency in samples.
+    // [main-thread & (being-activated | active)]
+    .get = [] (const clap_plugin_t* plugin) -> uint32_t {
+        return detail::from (plugin).latency;
+    }
+};
+
+static const clap_plugin_tail_t _tail = {
+    // Returns tail length in samples.
+    // Any value greater or equal to INT32_MAX implies infinite tail.
+    // [main-thread,audio-thread]
+    .get = [] (const clap_plugin_t* plugin) -> uint32_t {
+        return detail::from (plugin).tail.load (std::memory_order_relaxed);
+    }
+};
+
+static const clap_plugin_render_t _render = {
+    // Returns true if the plugin has a hard requirement to process in real-time.
+    // This is especially useful for plugin acting as a proxy to an hardware device.
+    // [main-thread]
+    .has_hard_realtime_requirement = [] (const clap_plugin_t*) -> bool {
+        return false;
+    },
+
+    // Returns true if the rendering mode could be applied.
+    // [main-thread]
+    .set = [] (const clap_plugin_t* plugin, clap_plugin_render_mode mode) -> bool {
+        detail::from (plugin).offline.store (mode == CLAP_RENDER_OFFLINE, std::memory_order_relaxed);
+        return true;
+    }
+};
+
+static const clap_plugin_thread_pool_t _thread_pool = {
+    // Called by the thread pool
+    .exec = [] (const clap_plugin_t* plugin, uint32_t task_index) {
+        detail::from (plugin).tasks.exec (task_index);
+    }
+};
+
+static const clap_plugin_surround_t _surround = {
+    // Checks if a given channel mask is supported.
+    // The channel mask is a bitmask, for example:
+    //   (1 << CLAP_SURROUND_FL) | (1 << CLAP_SURROUND_FR) | ...
+    // [main-thread]
+    .is_channel_mask_supported = [] (const clap_plugin_t*, uint64_t channel_mask) -> bool {
+        for (const auto& pc : port_configs)
+            if (pc.is_surround() && pc.channel_mask() == channel_mask)
+                return true;
+        return false;
+    },
+
+    // Stores the surround identifier of each channel into the channel_map array.
+    // Returns the number of elements stored in channel_map.
+    // channel_map_capacity must be greater or equal to the channel count of the given port.
+    // [main-thread]
+    .get_channel_map = [] (const clap_plugin_t* plugin, bool is_input, uint32_t port_index,
+                           uint8_t* channel_map, uint32_t channel_map_capacity) -> uint32_t {
+        const auto& config = *detail::from (plugin).config;
+        if (! config.is_surround() || port_index >= (is_input ? config.input_port_count : 1)
+            || channel_map_capacity < config.output_channels)
+            return 0;
+
+        std::memcpy (channel_map, config.channel_map, config.output_channels);
+        return config.output_channels;
+    }
+};
+
 // Must be called after creating the plugin.
 // If init returns false, the host must destroy the plugin instance.
 // If init returns true, then the plugin is initialized and in the deactivated state.
@@ -142,29 +768,20 @@ static const clap_plugin_audio_ports_t _audio_ports = {
 static bool init (const clap_plugin_t* plugin) {
     auto& self = detail::from (plugin);
 
-    /* audio ports */
-    clap_audio_port_info_t info;
-    info.flags         = 0;
-    info.id            = 0;
-    info.in_place_pair = CLAP_INVALID_ID;
-    info.channel_count = 2;
-    info.port_type     = CLAP_PORT_STEREO;
-
-    detail::copy_name (info.name, "Input");
-    self.ins.push_back (info);
-    detail::copy_name (info.name, "Output");
-    self.outs.push_back (info);
+    /* audio ports, stereo until the host selects another configuration */
+    const Reverb::Parameters defaults;
+    self.params = defaults;
+    for (clap_id id = Ports::Wet; id <= Ports::ReducedRate; ++id)
+        self.shared.set (id, eVerb::get_param (id, defaults));
+    detail::select (self, port_configs[0]);
 
     /* parameters */
-    const Reverb::Parameters defaults;
-    self.reverb.reset();
-    self.reverb.setParameters (defaults);
 
-    for (uint32_t id = Ports::Wet; id <= Ports::Width; ++id) {
+    for (uint32_t id = Ports::Wet; id <= Ports::ReducedRate; ++id) {
         clap_param_info_t param;
         detail::copy_name (param.module, "Reverb");
         param.cookie    = nullptr;
-        param.flags     = 0;
+        param.flags     = CLAP_PARAM_IS_AUTOMATABLE | (eVerb::is_modulatable (id) ? CLAP_PARAM_IS_MODULATABLE : 0);
         param.id        = id;
         param.min_value = 0.0;
         param.max_value = 1.0;
@@ -190,6 +807,26 @@ static bool init (const clap_plugin_t* plugin) {
                 detail::copy_name (param.name, "Width");
                 param.default_value = defaults.width;
                 break;
+            case Ports::Quality:
+                detail::copy_name (param.name, "Quality");
+                param.flags         |= CLAP_PARAM_IS_STEPPED | CLAP_PARAM_IS_ENUM;
+                param.max_value     = 2.0;
+                param.default_value = defaults.quality;
+                break;
+            case Ports::Network:
+                detail::copy_name (param.name, "Tank");
+                param.flags         |= CLAP_PARAM_IS_STEPPED | CLAP_PARAM_IS_ENUM;
+                param.default_value = defaults.network;
+                break;
+            case Ports::Size:
+                detail::copy_name (param.name, "Size");
+                param.default_value = defaults.size;
+                break;
+            case Ports::ReducedRate:
+                detail::copy_name (param.name, "Reduced Rate");
+                param.flags         |= CLAP_PARAM_IS_STEPPED | CLAP_PARAM_IS_ENUM;
+                param.default_value = defaults.reducedRate;
+                break;
         }
 
         self.param_info.push_back (param);
@@ -199,6 +836,13 @@ static bool init (const clap_plugin_t* plugin) {
         self.timer = timer;
     }
 
+    self.log          = (const clap_host_log_t*) self.host->get_extension (self.host, CLAP_EXT_LOG);
+    self.host_latency = (const clap_host_latency_t*) self.host->get_extension (self.host, CLAP_EXT_LATENCY);
+    self.host_tail    = (const clap_host_tail_t*) self.host->get_extension (self.host, CLAP_EXT_TAIL);
+    self.host_params  = (const clap_host_params_t*) self.host->get_extension (self.host, CLAP_EXT_PARAMS);
+    self.tasks.host   = self.host;
+    self.tasks.pool   = (const clap_host_thread_pool_t*) self.host->get_extension (self.host, CLAP_EXT_THREAD_POOL);
+
     return true;
 }
 
@@ -222,7 +866,33 @@ static bool activate (const clap_plugin_t* plugin,
                             uint32_t min_frames_count,
                             uint32_t max_frames_count) {
     auto& self = detail::from (plugin);
-    self.reverb.setSampleRate (sample_rate);
+
+    // Anything posted since the last flush, so the engine starts with it.
+    self.receive (nullptr, nullptr);
+    self.reduced_rate    = self.params.reducedRate >= 0.5f;
+    self.restart_pending = false;
+
+    self.reverb->set_kernels();
+    self.reverb->set_min_tank_rate (self.reduced_rate ? reduced_tank_rate : 0.0);
+    self.use_task_pool (self.offline.load (std::memory_order_relaxed));
+    self.reverb->prepare (sample_rate, static_cast<int> (max_frames_count));
+
+    const auto latency = static_cast<uint32_t> (self.reverb->latency());
+    if (latency != self.latency) {
+        self.latency = latency;
+        if (self.host_latency != nullptr)
+            self.host_latency->changed (self.host);
+    }
+
+    // The host asks for the tail after activating, no need to tell it.
+    self.tail.store (self.reverb->tail(), std::memory_order_relaxed);
+    self.tail_stale = false;
+
+    if (self.log != nullptr) {
+        const auto msg = std::string ("eVerb: using ") + self.reverb->kernel_name() + " kernels";
+        self.log->log (self.host, CLAP_LOG_INFO, msg.c_str());
+    }
+
     return true;
 }
 // [main-thread & active]
@@ -251,7 +921,7 @@ static void stop_processing (const clap_plugin_t* plugin) {
 //
 // [audio-thread & active]
 static void reset (const clap_plugin_t* plugin) {
-    detail::from (plugin).reverb.reset();
+    detail::from (plugin).reverb->reset();
 }
 
 // process audio, events, ...
@@ -260,37 +930,49 @@ static void reset (const clap_plugin_t* plugin) {
 // [audio-thread & active & processing]
 static clap_process_status process (const clap_plugin_t* plugin,
                                           const clap_process_t* process) {
-    auto& self  = detail::from (plugin);
-    auto num_in = process->in_events->size (process->in_events);
-
-    {
-        std::lock_guard<std::mutex> sl (self.params_mutex);
-        bool param_changed = false;
-        for (uint32_t i = 0; i < num_in; ++i) {
-            auto ev = process->in_events->get (process->in_events, i);
-            switch (ev->type) {
-                case CLAP_EVENT_PARAM_VALUE: {
-                    auto pv = (const clap_event_param_value_t*) ev;
-                    self.update (pv);
-                    param_changed = true;
-                    break;
-                }
+    auto& self = detail::from (plugin);
+    auto in    = process->in_events;
+
+    const juce::ScopedNoDenormals no_denormals;
+
+    const bool offline = self.offline.load (std::memory_order_relaxed);
+    if (offline != self.pool_offline)
+        self.use_task_pool (offline);
+
+    // Parameter events take effect at their own frame: the block is rendered in runs split
+    // at them, with events close together applied at once. Offline the runs are longer.
+    uint32_t automated = 0;
+    bool param_changed = self.take_posted (process->out_events);
+    bool silent        = true;
+    bool rendered      = false;
+
+    renderAutomated (
+        static_cast<int> (process->frames_count),
+        static_cast<int> (in->size (in)),
+        [&] (int i) { return in->get (in, static_cast<uint32_t> (i))->time; },
+        [&] (int i) { param_changed = self.take_event (in->get (in, static_cast<uint32_t> (i)), automated) || param_changed; },
+        [&] (int start, int frames) {
+            if (param_changed) {
+                self.apply_params();
+                param_changed = false;
             }
-        }
 
-        if (param_changed)
-            self.apply_params();
-    }
+            silent   = self.reverb->process (process, static_cast<uint32_t> (start), static_cast<uint32_t> (frames)) && silent;
+            rendered = true;
+        },
+        offline ? offlineAutomationGranularity : automationGranularity);
+
+    if (param_changed)
+        self.apply_params();
 
-    auto& ain  = process->audio_inputs[0];
-    auto& aout = process->audio_outputs[0];
-    self.reverb.processStereo (ain.data32[0],
-                               ain.data32[1],
-                               aout.data32[0],
-                               aout.data32[1],
-                               static_cast<int> (process->frames_count));
+    self.notify (automated);
 
-    return CLAP_PROCESS_CONTINUE;
+    // When the whole block was silent, tell the host the outputs are constant and let it stop
+    // calling until the input changes. A call without frames has confirmed nothing.
+    silent               = silent && rendered;
+    auto& output         = process->audio_outputs[0];
+    output.constant_mask = ! silent ? 0 : (output.channel_count < 64 ? (uint64_t (1) << output.channel_count) - 1 : ~uint64_t (0));
+    return silent ? CLAP_PROCESS_SLEEP : CLAP_PROCESS_CONTINUE;
 }
 
 // Called by the host on the main thread in response to a previous call to:
@@ -331,6 +1013,10 @@ private:
 }
 #endif
 
+static const char* const quality_names[]      = { "Eco", "Standard", "Dense" };
+static const char* const network_names[]      = { "FreeVerb", "FDN" };
+static const char* const reduced_rate_names[] = { "Off", "On" };
+
 // Returns the number of parameters.
 // [main-thread]
 static uint32_t params_count (const clap_plugin_t* plugin) {
@@ -360,24 +1046,7 @@ static bool params_get_value (const clap_plugin_t* plugin, clap_id param_id, dou
     auto& self = detail::from (plugin);
     for (const auto& param : self.param_info) {
         if (param.id == param_id) {
-            const auto vals = self.safe_params();
-            switch (param_id) {
-                case Ports::Wet:
-                    *out_value = vals.wetLevel;
-                    break;
-                case Ports::Dry:
-                    *out_value = vals.dryLevel;
-                    break;
-                case Ports::RoomSize:
-                    *out_value = vals.roomSize;
-                    break;
-                case Ports::Width:
-                    *out_value = vals.width;
-                    break;
-                case Ports::Damping:
-                    *out_value = vals.damping;
-                    break;
-            }
+            *out_value = self.shared.get (param_id);
             return true;
         }
     }
@@ -394,9 +1063,16 @@ static bool params_value_to_text (const clap_plugin_t* plugin,
                                         double value,
                                         char* out_buffer,
                                         uint32_t out_buffer_capacity) {
-    juce::ignoreUnused (plugin, param_id);
+    juce::ignoreUnused (plugin);
 
     juce::String buf (value);
+    if (param_id == Ports::Quality)
+        buf = quality_names[juce::jlimit (0, 2, juce::roundToInt (value))];
+    else if (param_id == Ports::Network)
+        buf = network_names[value >= 0.5 ? 1 : 0];
+    else if (param_id == Ports::ReducedRate)
+        buf = reduced_rate_names[value >= 0.5 ? 1 : 0];
+
     auto size = std::min (buf.getNumBytesAsUTF8(), (size_t) out_buffer_capacity);
     std::strncpy (out_buffer, buf.toRawUTF8(), size);
     return true;
@@ -410,9 +1086,25 @@ static bool params_text_to_value (const clap_plugin_t* plugin,
                                         clap_id param_id,
                                         const char* param_value_text,
                                         double* out_value) {
-    juce::ignoreUnused (plugin, param_id);
+    juce::ignoreUnused (plugin);
     const auto str = juce::String::fromUTF8 (param_value_text);
     *out_value     = str.getDoubleValue();
+
+    if (param_id == Ports::Quality)
+        for (int i = 0; i < 3; ++i)
+            if (str.trim().equalsIgnoreCase (quality_names[i]))
+                *out_value = i;
+
+    if (param_id == Ports::Network)
+        for (int i = 0; i < 2; ++i)
+            if (str.trim().equalsIgnoreCase (network_names[i]))
+                *out_value = i;
+
+    if (param_id == Ports::ReducedRate)
+        for (int i = 0; i < 2; ++i)
+            if (str.trim().equalsIgnoreCase (reduced_rate_names[i]))
+                *out_value = i;
+
     return true;
 }
 
@@ -428,7 +1120,7 @@ static bool params_text_to_value (const clap_plugin_t* plugin,
 static void params_flush (const clap_plugin_t* plugin,
                                 const clap_input_events_t* in,
                                 const clap_output_events_t* out) {
-    juce::ignoreUnused (plugin, in, out);
+    detail::from (plugin).receive (in, out);
 }
 
 static const clap_plugin_params_t _params = {
@@ -448,14 +1140,18 @@ static const clap_plugin_params_t _params = {
 static bool load (const clap_plugin_t* plugin, const clap_istream_t* stream) {
     auto& self = detail::from (plugin);
     Reverb::Parameters params;
-    if (sizeof (params) != stream->read (stream, &params, sizeof (params)))
+
+    // States saved before 1.2 end where the quality parameter starts; the rest keep their
+    // defaults.
+    const auto size = stream->read (stream, &params, sizeof (params));
+    if (size != sizeof (params) && size != offsetof (Reverb::Parameters, quality))
         return false;
 
-    {
-        std::lock_guard<std::mutex> sl (self.params_mutex);
-        self.params = params;
-        self.apply_params();
-    }
+    // Posted like gui changes but not sent back: the host knows it loaded a state.
+    for (clap_id id = Ports::Wet; id <= Ports::ReducedRate; ++id)
+        self.post (id, eVerb::get_param (id, params), false);
+
+    self.request_flush();
     self.sync_params();
     return true;
 }
@@ -528,9 +1224,8 @@ static bool ui_create (const clap_plugin_t* plugin, const char* api, bool is_flo
         self.gui                         = std::make_unique<lui::Main> (lui::Mode::MODULE, std::make_unique<lui::Cairo>());
         self.content                     = std::make_unique<Content>();
         self.content->on_control_changed = [&] (uint32_t port, float value) {
-            std::lock_guard<std::mutex> sl (self.params_mutex);
-            self.update (port, value);
-            self.apply_params();
+            self.post (port, value, true);
+            self.request_flush();
         };
         self.timer->register_timer (self.host, 20, &self.idle_timer);
     }
@@ -677,8 +1372,10 @@ static const clap_plugin_gui_t _gui = {
 //==============================================================================
 static void on_timer (const clap_plugin_t* plugin, clap_id timer_id) {
     auto& self = detail::from (plugin);
-    if (self.gui != nullptr && timer_id == self.idle_timer)
+    if (self.gui != nullptr && timer_id == self.idle_timer) {
+        self.sync_automation();
         self.gui->loop (0.0);
+    }
 }
 
 static const clap_plugin_timer_support_t _timer {
@@ -694,7 +1391,7 @@ static const clap_plugin_descriptor_t _everb = {
     .url          = "https://github.com/kushview/everb",
     .manual_url   = "https://github.com/kushview/everb",
     .support_url  = "https://github.com/kushview/everb",
-    .version      = "1.0.2",
+    .version      = "1.2.0",
     .description  = "A very simple reverb that uses juce::Reverb",
     .features     = { nullptr }
 };
@@ -707,6 +1404,18 @@ static const clap_plugin_descriptor_t _everb = {
 static const void* get_extension (const clap_plugin_t*, const char* id) {
     if (0 == std::strcmp (id, CLAP_EXT_AUDIO_PORTS)) {
         return &_audio_ports;
+    } else if (0 == std::strcmp (id, CLAP_EXT_AUDIO_PORTS_CONFIG)) {
+        return &_audio_ports_config;
+    } else if (0 == std::strcmp (id, CLAP_EXT_SURROUND)) {
+        return &_surround;
+    } else if (0 == std::strcmp (id, CLAP_EXT_LATENCY)) {
+        return &_latency;
+    } else if (0 == std::strcmp (id, CLAP_EXT_TAIL)) {
+        return &_tail;
+    } else if (0 == std::strcmp (id, CLAP_EXT_RENDER)) {
+        return &_render;
+    } else if (0 == std::strcmp (id, CLAP_EXT_THREAD_POOL)) {
+        return &_thread_pool;
     } else if (0 == std::strcmp (id, CLAP_EXT_PARAMS)) {
         return &_params;
     } else if (0 == std::strcmp (id, CLAP_EXT_STATE)) {
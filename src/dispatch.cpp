@@ -0,0 +1,133 @@
+/*
+    This file is part of eVerb
+
+    Copyright (C) 2015-2025  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "juceconfig.hpp"
+#include <juce_core/juce_core.h>
+
+#include "kernels.hpp"
+
+namespace everb {
+
+// Defined in kernels.cpp, once per instruction set.
+#define EVERB_DECLARE_KERNELS(isa)                                                      \
+    namespace isa {                                                                     \
+    template <int numCombs, int numChannels, typename SampleType, typename StorageType> \
+    const Kernels<numCombs, numChannels, SampleType, StorageType>& kernels() noexcept;  \
+    template <int numCombs, int numLanes, typename SampleType>                          \
+    const BankKernels<numCombs, numLanes, SampleType>& bankKernels() noexcept;          \
+    }
+
+#if JUCE_INTEL
+EVERB_DECLARE_KERNELS (isa_sse2)
+#    define EVERB_BASELINE_ISA isa_sse2
+#else
+EVERB_DECLARE_KERNELS (isa_generic)
+#    define EVERB_BASELINE_ISA isa_generic
+#endif
+
+#if EVERB_KERNELS_AVX2
+EVERB_DECLARE_KERNELS (isa_avx2)
+#endif
+#if EVERB_KERNELS_AVX512
+EVERB_DECLARE_KERNELS (isa_avx512)
+#endif
+
+namespace {
+enum class Isa { baseline, avx2, avx512 };
+
+// The widest kernel variant that was built and that the running CPU supports.
+Isa bestIsa() noexcept {
+    using juce::SystemStats;
+
+#if EVERB_KERNELS_AVX512
+    if (SystemStats::hasAVX512F() && SystemStats::hasAVX512VL() && SystemStats::hasAVX512DQ()
+        && SystemStats::hasAVX2() && SystemStats::hasFMA3())
+        return Isa::avx512;
+#endif
+#if EVERB_KERNELS_AVX2
+    if (SystemStats::hasAVX2() && SystemStats::hasFMA3())
+        return Isa::avx2;
+#endif
+    return Isa::baseline;
+}
+} // namespace
+
+template <int numCombs, int numChannels, typename SampleType, typename StorageType>
+const Kernels<numCombs, numChannels, SampleType, StorageType>& Kernels<numCombs, numChannels, SampleType, StorageType>::baseline() noexcept {
+    return EVERB_BASELINE_ISA::kernels<numCombs, numChannels, SampleType, StorageType>();
+}
+
+template <int numCombs, int numChannels, typename SampleType, typename StorageType>
+const Kernels<numCombs, numChannels, SampleType, StorageType>& Kernels<numCombs, numChannels, SampleType, StorageType>::best() noexcept {
+    static const Kernels& best = []() -> const Kernels& {
+        switch (bestIsa()) {
+#if EVERB_KERNELS_AVX512
+            case Isa::avx512:
+                return isa_avx512::kernels<numCombs, numChannels, SampleType, StorageType>();
+#endif
+#if EVERB_KERNELS_AVX2
+            case Isa::avx2:
+                return isa_avx2::kernels<numCombs, numChannels, SampleType, StorageType>();
+#endif
+            default:
+                return baseline();
+        }
+    }();
+
+    return best;
+}
+
+template <int numCombs, int numLanes, typename SampleType>
+const BankKernels<numCombs, numLanes, SampleType>& BankKernels<numCombs, numLanes, SampleType>::baseline() noexcept {
+    return EVERB_BASELINE_ISA::bankKernels<numCombs, numLanes, SampleType>();
+}
+
+template <int numCombs, int numLanes, typename SampleType>
+const BankKernels<numCombs, numLanes, SampleType>& BankKernels<numCombs, numLanes, SampleType>::best() noexcept {
+    static const BankKernels& best = []() -> const BankKernels& {
+        switch (bestIsa()) {
+#if EVERB_KERNELS_AVX512
+            case Isa::avx512:
+                return isa_avx512::bankKernels<numCombs, numLanes, SampleType>();
+#endif
+#if EVERB_KERNELS_AVX2
+            case Isa::avx2:
+                return isa_avx2::bankKernels<numCombs, numLanes, SampleType>();
+#endif
+            default:
+                return baseline();
+        }
+    }();
+
+    return best;
+}
+
+#define EVERB_INSTANTIATE_DISPATCH(c, n, s, d)                                    \
+    template const Kernels<c, n, s, d>& Kernels<c, n, s, d>::baseline() noexcept; \
+    template const Kernels<c, n, s, d>& Kernels<c, n, s, d>::best() noexcept;
+EVERB_KERNEL_TOPOLOGIES (EVERB_INSTANTIATE_DISPATCH)
+#undef EVERB_INSTANTIATE_DISPATCH
+
+#define EVERB_INSTANTIATE_BANK_DISPATCH(c, n, s)                                    \
+    template const BankKernels<c, n, s>& BankKernels<c, n, s>::baseline() noexcept; \
+    template const BankKernels<c, n, s>& BankKernels<c, n, s>::best() noexcept;
+EVERB_BANK_TOPOLOGIES (EVERB_INSTANTIATE_BANK_DISPATCH)
+#undef EVERB_INSTANTIATE_BANK_DISPATCH
+
+} // namespace everb
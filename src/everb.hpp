@@ -1,10 +1,16 @@
-
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <type_traits>
+
 #include "juceconfig.hpp"
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_core/juce_core.h>
 
+#include "kernels.hpp"
+
 /*
   ==============================================================================
 
@@ -29,39 +35,294 @@
 
 // modified to allow non-replacing render.
 
+namespace everb {
+
+//==============================================================================
+/** Holds the parameters being used by a Reverb object. */
+struct ReverbParameters {
+    float roomSize    = 0.5f;  /**< Room size, 0 to 1.0, where 1.0 is big, 0 is small. */
+    float damping     = 0.5f;  /**< Damping, 0 to 1.0, where 0 is not damped, 1.0 is fully damped. */
+    float wetLevel    = 0.33f; /**< Wet level, 0 to 1.0 */
+    float dryLevel    = 0.4f;  /**< Dry level, 0 to 1.0 */
+    float width       = 1.0f;  /**< Reverb width, 0 to 1.0, where 1.0 is very wide. */
+    float freezeMode  = 0.0f;  /**< Freeze mode - values < 0.5 are "normal" mode, values > 0.5
+                                       put the reverb into a continuous feedback loop. */
+    float quality     = 1.0f;  /**< Quality tier of a TieredReverb, see ReverbQuality. Engines
+                                       of a fixed topology ignore it. */
+    float reducedRate = 0.0f;  /**< Values >= 0.5 ask a plugin to run the tank at a reduced rate
+                                       in high rate sessions, see ReverbEngine::setMinTankRate().
+                                       The engines ignore it, as it only applies on activation. */
+    float network     = 0.0f;  /**< Values >= 0.5 mix each channel's combs through a Hadamard
+                                       matrix, making the tank a feedback delay network. */
+    float size        = 1.0f;  /**< Size of the space, 0 to 1.0: scales every delay line from a
+                                       quarter of its FreeVerb length at 0 to all of it at 1.0. */
+};
+
+//==============================================================================
+/** Delay line lengths at 44.1 kHz for a topology, computed at compile time.
+
+    With 8 combs and 4 all-passes these are the FreeVerb tunings. Smaller counts pick
+    evenly spaced entries from the FreeVerb tables. Larger counts spread new lengths
+    between the shortest and longest FreeVerb length, rounded to primes so no two lines
+    share a period.
+*/
+template <int numCombs, int numAllPasses>
+struct ReverbTunings {
+    static constexpr int stereoSpread = 23;
+
+    static constexpr std::array<short, numCombs> combs() {
+        constexpr short freeVerb[] = { 1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617 };
+        return spread<numCombs> (freeVerb);
+    }
+
+    static constexpr std::array<short, numAllPasses> allPasses() {
+        constexpr short freeVerb[] = { 556, 441, 341, 225 };
+        return spread<numAllPasses> (freeVerb);
+    }
+
+    /** Returns the spread of each channel, the samples added to all of its line lengths.
+
+        The first two channels get FreeVerb's stereo spread. Every further channel steps on by
+        at least as much, skipping any spread that would give one of its lines the length of
+        a line on another channel, so no two channels share a period.
+    */
+    template <int numChannels>
+    static constexpr std::array<short, numChannels> spreads() {
+        std::array<short, numChannels> out {};
+        for (int c = 1; c < numChannels; ++c) {
+            int spread = out[c - 1] + stereoSpread;
+            while (sharesLength (out.data(), c, spread))
+                ++spread;
+            out[c] = (short) spread;
+        }
+        return out;
+    }
+
+    /** Returns the length in samples at sampleRate of a line tuned to length at 44.1 kHz. */
+    static constexpr int scale (const int length, const double sampleRate) {
+        return ((int) sampleRate * length) / 44100;
+    }
+
+private:
+    static constexpr int numLines = numCombs + numAllPasses;
+
+    static constexpr int lineLength (const int line) {
+        return line < numCombs ? combs()[line] : allPasses()[line - numCombs];
+    }
+
+    static constexpr bool sharesLength (const short* const spreads, const int numChannels, const int spread) {
+        for (int c = 0; c < numChannels; ++c)
+            for (int i = 0; i < numLines; ++i)
+                for (int j = 0; j < numLines; ++j)
+                    if (lineLength (i) + spread == lineLength (j) + spreads[c])
+                        return true;
+        return false;
+    }
+
+    static constexpr bool isPrime (const int n) {
+        for (int d = 2; d * d <= n; ++d)
+            if (n % d == 0)
+                return false;
+        return n > 1;
+    }
+
+    static constexpr int nearestPrime (const int n) {
+        for (int k = 0;; ++k) {
+            if (isPrime (n - k))
+                return n - k;
+            if (isPrime (n + k))
+                return n + k;
+        }
+    }
+
+    template <int size, int sourceSize>
+    static constexpr std::array<short, size> spread (const short (&source)[sourceSize]) {
+        std::array<short, size> out {};
+        for (int i = 0; i < size; ++i) {
+            if (size == sourceSize)
+                out[i] = source[i];
+            else if (size < sourceSize)
+                out[i] = source[size > 1 ? (i * (sourceSize - 1) + (size - 1) / 2) / (size - 1) : 0];
+            else
+                out[i] = (short) nearestPrime (source[0] + (source[sourceSize - 1] - source[0]) * i / (size - 1));
+        }
+        return out;
+    }
+};
+
+//==============================================================================
+/** The gains and filter coefficients a set of ReverbParameters maps to, as in FreeVerb. */
+template <typename SampleType, int numCombs>
+struct ReverbCoefficients {
+    explicit ReverbCoefficients (const ReverbParameters& params) noexcept {
+        const SampleType wetScaleFactor  = 3.0f;
+        const SampleType dryScaleFactor  = 2.0f;
+        const SampleType roomScaleFactor = 0.28f;
+        const SampleType roomOffset      = 0.7f;
+        const SampleType dampScaleFactor = 0.4f;
+
+        // FreeVerb's input gain is tuned for 8 combs; keep the wet level with other counts.
+        const SampleType fixedGain = 0.015f * 8.0f / numCombs;
+
+        const SampleType wet = params.wetLevel * wetScaleFactor;
+        dry                  = params.dryLevel * dryScaleFactor;
+        wet1                 = 0.5f * wet * (1.0f + params.width);
+        wet2                 = 0.5f * wet * (1.0f - params.width);
+
+        if (params.freezeMode >= 0.5f) {
+            gain     = 0;
+            damping  = 0;
+            feedback = 1;
+        } else {
+            gain     = fixedGain;
+            damping  = params.damping * dampScaleFactor;
+            feedback = params.roomSize * roomScaleFactor + roomOffset;
+        }
+
+        lineScale = 0.25f + 0.75f * juce::jlimit (0.0f, 1.0f, params.size);
+    }
+
+    SampleType gain, dry, wet1, wet2, damping, feedback, lineScale;
+};
+
+//==============================================================================
+/** One allocation holding every delay line of an engine.
+
+    Lines are carved out back to back, each padded to whole cache lines so that no two
+    share one, and the filters' read/write state lives in compact headers (CombLanes,
+    AllPassLine, LaneLine) instead of next to each buffer.
+*/
+template <typename StorageType>
+class DelayArena {
+public:
+    DelayArena() noexcept {}
+
+    static constexpr size_t cacheLineSize = 64;
+
+    /** Returns the samples a line of numSamples takes up in the arena. */
+    static constexpr size_t paddedSize (const int numSamples) noexcept {
+        constexpr size_t perLine = cacheLineSize / sizeof (StorageType);
+        return ((size_t) numSamples + perLine - 1) / perLine * perLine;
+    }
+
+    /** Makes sure the arena holds at least numSamples. It never shrinks. */
+    void reserve (const size_t numSamples) {
+        if (numSamples > capacity) {
+            storage.malloc (numSamples * sizeof (StorageType) + cacheLineSize - 1);
+            capacity = numSamples;
+        }
+    }
+
+    /** Makes room for numSamples and returns the first, aligned to a cache line. Only
+        allocates if numSamples is more than was reserved before.
+    */
+    StorageType* allocate (const size_t numSamples) {
+        reserve (numSamples);
+
+        const auto address = reinterpret_cast<uintptr_t> (storage.get());
+        return reinterpret_cast<StorageType*> ((address + cacheLineSize - 1) & ~(uintptr_t) (cacheLineSize - 1));
+    }
+
+    /** Frees the memory, for an owner that has moved its lines elsewhere. */
+    void release() noexcept {
+        storage.free();
+        capacity = 0;
+    }
+
+    /** Returns the number of bytes allocated. */
+    size_t getNumBytes() const noexcept {
+        return capacity > 0 ? capacity * sizeof (StorageType) + cacheLineSize - 1 : 0;
+    }
+
+private:
+    juce::HeapBlock<char> storage;
+    size_t capacity = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (DelayArena)
+};
+
+//==============================================================================
+/** Returns true if numSamples of every one of numChannels buffers are zero: the input that
+    lets a reverb whose tail has died away be skipped, see ReverbEngine::skipSilence().
+*/
+template <typename IOType>
+bool isSilence (const IOType* const* const channels, const int numChannels, const int numSamples) noexcept {
+    for (int c = 0; c < numChannels; ++c)
+        for (int i = 0; i < numSamples; ++i)
+            if (channels[c][i] != IOType())
+                return false;
+    return true;
+}
+
+//==============================================================================
+/** Threads a reverb can borrow to run independent parts of a block at once, such as a
+    host's thread pool. See ReverbEngine::setTaskPool().
+*/
+struct TaskPool {
+    /** One of the parts, index counting from 0. */
+    using Task = void (*) (void* context, int index) noexcept;
+
+    virtual ~TaskPool() = default;
+
+    /** Calls task (context, index) for every index below numTasks, on any threads including
+        the calling one, and returns once they have all returned. Returns false without
+        calling any if no threads are free, and the caller runs them itself.
+    */
+    virtual bool run (Task task, void* context, int numTasks) noexcept = 0;
+};
+
 //==============================================================================
 /**
     Performs a simple reverb effect on a stream of audio data.
 
-    This is a simple stereo reverb, based on the technique and tunings used in FreeVerb.
-    Use setSampleRate() to prepare it, and then call processStereo() or processMono() to
-    apply the reverb to your audio data.
+    This is a simple reverb, based on the technique and tunings used in FreeVerb. The
+    topology (combs and all-passes per channel, number of channels) and the sample type
+    are fixed at compile time, so the filter loops are unrolled for exactly that shape.
+    Use prepare() or setSampleRate() to set it up, and then call processStereo() or
+    processMono() to apply the reverb to your audio data.
+
+    With ReverbParameters::network set, the combs of each channel form a feedback delay
+    network instead: their damped outputs are mixed through a Hadamard matrix before being
+    fed back, which builds up echo density faster from the same delay lines. As the matrix
+    diffuses the echoes itself, the network only runs the two shortest all-passes of each
+    channel. Both share the delay memory, so switching between them while running is
+    seamless.
+
+    SampleType is what the filters compute in. Either precision can process float or double
+    host buffers directly; the dry path is always scaled in the precision of the host
+    buffers. StorageType is what the delay lines hold, by default the same as SampleType;
+    Half halves the delay memory at a small cost in noise floor (see Kernels).
 
-    @see ReverbAudioSource
+    @see Reverb, ReverbCompact
 
     @tags{Audio}
 */
-namespace everb {
-
-class Reverb {
+template <int numCombs, int numAllPasses, int numChannels, typename SampleType, typename StorageType = SampleType>
+class ReverbEngine {
 public:
+    static_assert (numCombs > 0 && (numCombs & (numCombs - 1)) == 0, "comb outputs are summed pairwise");
+    static_assert (numAllPasses > 0 && numChannels > 0, "empty topology");
+
+    using Parameters   = ReverbParameters;
+    using KernelTable  = Kernels<numCombs, numChannels, SampleType, StorageType>;
+    using Tunings      = ReverbTunings<numCombs, numAllPasses>;
+    using Coefficients = ReverbCoefficients<SampleType, numCombs>;
+    using Taps         = ResamplerTaps<SampleType>;
+
     //==============================================================================
-    Reverb() {
+    ReverbEngine() {
         setParameters (Parameters());
         setSampleRate (44100.0);
     }
 
     //==============================================================================
-    /** Holds the parameters being used by a Reverb object. */
-    struct Parameters {
-        float roomSize   = 0.5f;  /**< Room size, 0 to 1.0, where 1.0 is big, 0 is small. */
-        float damping    = 0.5f;  /**< Damping, 0 to 1.0, where 0 is not damped, 1.0 is fully damped. */
-        float wetLevel   = 0.33f; /**< Wet level, 0 to 1.0 */
-        float dryLevel   = 0.4f;  /**< Dry level, 0 to 1.0 */
-        float width      = 1.0f;  /**< Reverb width, 0 to 1.0, where 1.0 is very wide. */
-        float freezeMode = 0.0f;  /**< Freeze mode - values < 0.5 are "normal" mode, values > 0.5
-                                          put the reverb into a continuous feedback loop. */
-    };
+    /** Chooses the processing kernels, e.g. KernelTable::best(). Until this is called the
+        reverb uses KernelTable::baseline(). Don't call this in parallel with processing.
+    */
+    void setKernels (const KernelTable& newKernels) noexcept { kernels = &newKernels; }
+
+    /** Returns the processing kernels in use, see Kernels::name. */
+    const KernelTable& getKernels() const noexcept { return *kernels; }
 
     //==============================================================================
     /** Returns the reverb's current parameters. */
@@ -72,39 +333,102 @@ public:
         the process method, you may get artifacts.
     */
     void setParameters (const Parameters& newParams) {
-        const float wetScaleFactor = 3.0f;
-        const float dryScaleFactor = 2.0f;
-
-        const float wet = newParams.wetLevel * wetScaleFactor;
-        dryGain.setTargetValue (newParams.dryLevel * dryScaleFactor);
-        wetGain1.setTargetValue (0.5f * wet * (1.0f + newParams.width));
-        wetGain2.setTargetValue (0.5f * wet * (1.0f - newParams.width));
-
-        gain       = isFrozen (newParams.freezeMode) ? 0.0f : 0.015f;
+        const Coefficients c (newParams);
+        dryGain.setTargetValue (c.dry);
+        wetGain1.setTargetValue (c.wet1);
+        wetGain2.setTargetValue (c.wet2);
+        damping.setTargetValue (c.damping);
+        feedback.setTargetValue (c.feedback);
+        lineScale.setTargetValue (c.lineScale);
+
+        // The all-passes the network skips still hold the echoes from before it.
+        if (network && newParams.network < 0.5f)
+            for (auto& chain : allPasses)
+                for (int i = 0; i < firstNetworkAllPass; ++i)
+                    chain.clear (i);
+
+        gain       = c.gain;
+        network    = newParams.network >= 0.5f;
         parameters = newParams;
-        updateDamping();
     }
 
     //==============================================================================
+    /** Reserves the delay memory for every sample rate up to maxSampleRate, and sets the
+        sample rate to it. Call this from the host's activate; afterwards, setSampleRate()
+        with any rate up to maxSampleRate only re-slices the reserved memory and never
+        allocates.
+
+        maxBlockSize is the largest block the host will pass. The engine processes in
+        fixed internal slices, so it only sizes the buffers for running up to 4096 frames at
+        a time on a TaskPool, and only if one was set, see setTaskPool().
+    */
+    void prepare (const double maxSampleRate, const int maxBlockSize) {
+        jassert (maxSampleRate > 0);
+        reserveBlock (taskPool != nullptr && numChannels > 1 ? maxBlockSize : 0);
+
+        if (delayMemory == nullptr)
+            arena.reserve (getDelaySamples (maxSampleRate));
+        else
+            arena.release();
+
+        setSampleRate (maxSampleRate);
+    }
+
+    /** Returns how many StorageType samples of delay memory prepare (maxSampleRate) reserves,
+        at the current setMinTankRate().
+    */
+    size_t getDelaySamples (const double maxSampleRate) const noexcept {
+        // Below twice minTankRate the tank runs at the host rate, so the largest tank rate
+        // up to maxSampleRate is either just short of that or maxSampleRate / maxFactor.
+        double maxTankRate = maxSampleRate;
+        if (minTankRate > 0)
+            maxTankRate = juce::jmin (maxSampleRate, juce::jmax (2 * minTankRate, maxSampleRate / Taps::maxFactor));
+
+        return LineSizes (maxTankRate).total;
+    }
+
+    /** Lays the delay lines out in memory the caller owns, instead of the engine's own, from
+        the next prepare() or setSampleRate() on. It must be aligned to a cache line and hold
+        getDelaySamples() for every rate it's used at; prepare() then frees the engine's own
+        memory instead of reserving it. nullptr, the default, goes back to the engine's own.
+
+        Several engines may share memory as long as only one at a time processes: setting
+        the rate or resetting an engine doesn't touch its lines, they are zeroed as it runs.
+    */
+    void setDelayMemory (StorageType* const memory) noexcept {
+        jassert (reinterpret_cast<uintptr_t> (memory) % DelayArena<StorageType>::cacheLineSize == 0);
+        delayMemory = memory;
+    }
+
     /** Sets the sample rate that will be used for the reverb.
         You must call this before the process methods, in order to tell it the correct sample rate.
+        This only allocates when the rate is higher than any this engine was prepared for.
     */
     void setSampleRate (const double sampleRate) {
         jassert (sampleRate > 0);
 
-        static const short combTunings[]    = { 1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617 }; // (at 44100Hz)
-        static const short allPassTunings[] = { 556, 441, 341, 225 };
-        const int stereoSpread              = 23;
-        const int intSampleRate             = (int) sampleRate;
+        int factor = 1;
+        while (minTankRate > 0 && factor < Taps::maxFactor && sampleRate / (factor * 2) >= minTankRate)
+            factor *= 2;
 
-        for (int i = 0; i < numCombs; ++i) {
-            comb[0][i].setSize ((intSampleRate * combTunings[i]) / 44100);
-            comb[1][i].setSize ((intSampleRate * (combTunings[i] + stereoSpread)) / 44100);
+        if (factor != resampler.factor) {
+            designResampler (resampler, factor);
+            clearResampler();
         }
 
-        for (int i = 0; i < numAllPasses; ++i) {
-            allPass[0][i].setSize ((intSampleRate * allPassTunings[i]) / 44100);
-            allPass[1][i].setSize ((intSampleRate * (allPassTunings[i] + stereoSpread)) / 44100);
+        const LineSizes sizes (sampleRate / factor);
+        StorageType* next = delayMemory != nullptr ? delayMemory : arena.allocate (sizes.total);
+
+        for (int c = 0; c < numChannels; ++c) {
+            for (int i = 0; i < numCombs; ++i) {
+                combs.setLine (c * numCombs + i, next, sizes.combs[c][i]);
+                next += DelayArena<StorageType>::paddedSize (sizes.combs[c][i]);
+            }
+
+            for (int i = 0; i < numAllPasses; ++i) {
+                allPasses[c].setLine (i, next, sizes.allPasses[c][i]);
+                next += DelayArena<StorageType>::paddedSize (sizes.allPasses[c][i]);
+            }
         }
 
         const double smoothTime = 0.01;
@@ -113,192 +437,1690 @@ public:
         dryGain.reset (sampleRate, smoothTime);
         wetGain1.reset (sampleRate, smoothTime);
         wetGain2.reset (sampleRate, smoothTime);
+
+        // Moving the read taps glides the pitch of the tail, so size changes ramp slower.
+        lineScale.reset (sampleRate, 0.25);
+        scaleLines (lineScale.skip (0), true);
+    }
+
+    /** Lets the tank run at a fraction of high host rates, e.g. 48 kHz in a 96 or 192 kHz
+        session, for roughly that fraction of its CPU. The tank runs at the host rate divided
+        by 4 or 2, whichever is the largest that keeps it at or above minTankRate; the summed
+        input is decimated to it and each channel's wet signal interpolated back with polyphase
+        filters, and the dry signal delayed to match. 0, the default, runs the tank at the host
+        rate.
+
+        This takes effect at the next prepare() or setSampleRate(). prepare() still reserves
+        the delay memory of any rate up to its maximum, including those just short of twice
+        minTankRate, which run at the host rate. See getLatencySamples().
+    */
+    void setMinTankRate (const double newMinTankRate) noexcept {
+        jassert (newMinTankRate >= 0);
+        minTankRate = newMinTankRate;
+    }
+
+    /** Returns the rate set with setMinTankRate(). */
+    double getMinTankRate() const noexcept { return minTankRate; }
+
+    /** Lets processStereo() and processChannels() run the first and second half of the
+        channels' tanks at once, on pool's threads, for host blocks of at least minSamples.
+        The two only meet again at the wet mix. Shorter blocks, and any the pool can't take,
+        run on the calling thread; the output is the same either way, to within the last
+        bit of rounding. nullptr, the default, always runs on the calling thread.
+
+        Set the pool before prepare(), which reserves the buffers the halves work in;
+        after that only minSamples may change. The pool is called from the process methods.
+        A block at a reduced tank rate, or one while Size glides, runs on the calling thread.
+    */
+    void setTaskPool (TaskPool* const pool, const int minSamples) noexcept {
+        taskPool           = pool;
+        minParallelSamples = juce::jmax (1, minSamples);
+    }
+
+    /** Returns how many samples the whole output, wet and dry, lags the input by. This is 0
+        unless the tank runs at a reduced rate.
+    */
+    int getLatencySamples() const noexcept {
+        return resampler.factor > 1 ? resampler.factor * Taps::tapsPerPhase - 1 : 0;
+    }
+
+    /** Returns the number of bytes this engine occupies, delay lines included unless they
+        are in memory set with setDelayMemory().
+    */
+    size_t getMemoryUsage() const noexcept {
+        return sizeof (*this) + arena.getNumBytes() + (size_t) numBlockSlots * blockCapacity * sizeof (SampleType);
+    }
+
+    /** Calls visit (samples, numSamples) with every comb and all-pass line as it is at the
+        current sample rate, e.g. to check what a decaying tail leaves in them. A line that
+        hasn't been written all the way round since prepare() or reset() still holds stale
+        memory past its write head.
+    */
+    template <typename Visit>
+    void visitDelayLines (Visit&& visit) const {
+        for (int j = 0; j < numChannels * numCombs; ++j)
+            visit (static_cast<const StorageType*> (combs.lanes.buffer[j]), combs.lanes.size[j]);
+
+        for (const auto& chain : allPasses)
+            for (const auto& line : chain.lines)
+                visit (static_cast<const StorageType*> (line.buffer), line.size);
     }
 
-    /** Clears the reverb's buffers. */
+    /** Clears the reverb's buffers. This takes constant time and is safe to call from the
+        audio thread: the delay lines are marked stale and zeroed bit by bit as they're played.
+    */
     void reset() {
-        for (int j = 0; j < numChannels; ++j) {
+        combs.clear();
+
+        for (int j = 0; j < numChannels; ++j)
+            allPasses[j].clear();
+
+        clearResampler();
+        quietSamples = silentForever;
+    }
+
+    //==============================================================================
+    /** Returns how many samples the output keeps ringing after the input stops, until it's
+        80 dB down: the latency, plus the time the longest comb takes to decay that far at
+        the current feedback, plus the all-passes after it. The damping only speeds the
+        decay up, as does the network's mixing, so this is an upper bound. Returns -1 while
+        frozen, as the tail never ends.
+    */
+    int getTailSamples() const noexcept {
+        const double level = feedback.getTargetValue();
+        if (level >= 1)
+            return -1;
+
+        const double passes = std::log (1.0e-4) / std::log (juce::jmax (level, 1.0e-3));
+        int longest         = 0;
+
+        for (int c = 0; c < numChannels; ++c) {
+            int comb = 0, chain = 0;
             for (int i = 0; i < numCombs; ++i)
-                comb[j][i].clear();
+                comb = juce::jmax (comb, combs.lanes.target[c * numCombs + i]);
+            for (int i = firstAllPass(); i < numAllPasses; ++i)
+                chain += allPasses[c].lines[i].target;
 
-            for (int i = 0; i < numAllPasses; ++i)
-                allPass[j][i].clear();
+            longest = juce::jmax (longest, (int) std::ceil (passes * comb) + chain);
+        }
+
+        return getLatencySamples() + longest * resampler.factor;
+    }
+
+    /** Returns true once the reverb has gone quiet: its input has been silent, and its wet
+        signal below -100 dB, for longer than any echo takes to get through the tank. From
+        then on it only outputs silence until its input is something else, so a wrapper
+        seeing silent input can call skipSilence() instead of a process method.
+    */
+    bool isTailSilent() const noexcept {
+        int longest = 0;
+        for (int c = 0; c < numChannels; ++c) {
+            int path = 0;
+            for (int i = 0; i < numCombs; ++i)
+                path = juce::jmax (path, combs.lanes.target[c * numCombs + i]);
+            for (int i = firstAllPass(); i < numAllPasses; ++i)
+                path += allPasses[c].lines[i].target;
+
+            longest = juce::jmax (longest, path);
         }
+
+        return quietSamples >= getLatencySamples() + longest * resampler.factor;
+    }
+
+    /** Stands in for a process method while isTailSilent() is true and the input is
+        silent, see isSilence(): the output would be silence, so the caller only has to
+        clear its buffers. The filters are skipped and only the parameter ramps advance.
+    */
+    void skipSilence (const int numSamples) noexcept {
+        jassert (isTailSilent());
+        damping.skip (numSamples);
+        feedback.skip (numSamples);
+        dryGain.skip (numSamples);
+        wetGain1.skip (numSamples);
+        wetGain2.skip (numSamples);
+
+        // Nothing audible is left in the lines, so the read taps can jump.
+        const SampleType scale = lineScale.skip (numSamples);
+        if (scale != appliedScale)
+            scaleLines (scale, true);
     }
 
     //==============================================================================
-    /** Applies the reverb to two stereo channels of audio data. */
-    void processStereo (float* const left,
-                        float* const right,
-                        float* const out1, float* const out2,
+    /** Applies the reverb to two stereo channels of audio data.
+
+        The host block is processed in slices of at most maxBlockSize frames. Within a slice
+        every delay line runs over the whole slice before the next one starts, and the
+        wet/dry mix is done as a separate pass at the end.
+
+        The delay lines aren't guarded against denormals, so call this with flush-to-zero
+        enabled, e.g. inside a juce::ScopedNoDenormals, or a decaying tail gets slow.
+    */
+    template <typename IOType>
+    void processStereo (IOType* const left,
+                        IOType* const right,
+                        IOType* const out1, IOType* const out2,
                         const int numSamples) noexcept {
+        static_assert (numChannels == 2, "processStereo needs a two channel engine");
         JUCE_BEGIN_IGNORE_WARNINGS_MSVC (6011)
         jassert (left != nullptr && right != nullptr);
 
-        for (int i = 0; i < numSamples; ++i) {
-            const float input = (left[i] + right[i]) * gain;
-            float outL = 0, outR = 0;
+        const auto& mix = getMix<IOType>();
+        const bool parallel = processInParallel (
+            numSamples,
+            [&] (const int start, const int num, SampleType* const in) {
+                for (int i = 0; i < num; ++i)
+                    in[i] = SampleType (left[start + i] + right[start + i]) * gain;
+            },
+            [&] (const int start, const int num, const bool steady, SampleType* const* const wet, const SampleType* const* const ramps) {
+                (steady ? mix.steadyStereo : mix.stereo) (wet[0], wet[1], left + start, right + start, ramps[wet1Slot], ramps[wet2Slot], ramps[drySlot], out1 + start, out2 + start, num);
+            });
+
+        for (int start = parallel ? numSamples : 0; start < numSamples; start += maxBlockSize) {
+            const int num           = juce::jmin ((int) maxBlockSize, numSamples - start);
+            const IOType* const inL = left + start;
+            const IOType* const inR = right + start;
+
+            for (int i = 0; i < num; ++i)
+                input[i] = SampleType (inL[i] + inR[i]) * gain;
+
+            const bool steady = fillRamps (num);
+            runTank (num, steady, numChannels); // all combs of both channels in parallel, then the allpasses in series
+
+            alignas (64) IOType delayed[numChannels][maxBlockSize];
+            const IOType* const dryL = delayDry (0, inL, num, delayed[0]);
+            const IOType* const dryR = delayDry (1, inR, num, delayed[1]);
+
+            (steady ? mix.steadyStereo : mix.stereo) (wetOut[0], wetOut[1], dryL, dryR, wet1Ramp, wet2Ramp, dryRamp, out1 + start, out2 + start, num);
+        }
+        JUCE_END_IGNORE_WARNINGS_MSVC
+    }
+
+    /** Applies the reverb to a single mono channel of audio data. */
+    template <typename IOType>
+    void processMono (IOType* const samples, const int numSamples) noexcept {
+        processMono (samples, samples, numSamples);
+    }
 
-            const float damp    = damping.getNextValue();
-            const float feedbck = feedback.getNextValue();
+    /** Applies the reverb to a single mono channel of audio data, from in to out.
 
-            for (int j = 0; j < numCombs; ++j) // accumulate the comb filters in parallel
-            {
-                outL += comb[0][j].process (input, damp, feedbck);
-                outR += comb[1][j].process (input, damp, feedbck);
-            }
+        Only the first channel's filters run, so an engine with numChannels = 1 does the
+        work in half the memory of a stereo one.
+    */
+    template <typename IOType>
+    void processMono (const IOType* const in, IOType* const out, const int numSamples) noexcept {
+        JUCE_BEGIN_IGNORE_WARNINGS_MSVC (6011)
+        jassert (in != nullptr && out != nullptr);
 
-            for (int j = 0; j < numAllPasses; ++j) // run the allpass filters in series
-            {
-                outL = allPass[0][j].process (outL);
-                outR = allPass[1][j].process (outR);
-            }
+        for (int start = 0; start < numSamples; start += maxBlockSize) {
+            const int num             = juce::jmin ((int) maxBlockSize, numSamples - start);
+            const IOType* const block = in + start;
+
+            for (int i = 0; i < num; ++i)
+                input[i] = SampleType (block[i]) * gain;
 
-            const float dry  = dryGain.getNextValue();
-            const float wet1 = wetGain1.getNextValue();
-            const float wet2 = wetGain2.getNextValue();
+            const bool steady = fillRamps (num);
+            runTank (num, steady, 1); // first channel's filters only
 
-            out1[i] = outL * wet1 + outR * wet2 + left[i] * dry;
-            out2[i] = outR * wet1 + outL * wet2 + right[i] * dry;
+            alignas (64) IOType delayed[maxBlockSize];
+            const IOType* const dry = delayDry (0, block, num, delayed);
+
+            const auto& mix = getMix<IOType>();
+            (steady ? mix.steadyMono : mix.mono) (wetOut[0], dry, wet1Ramp, dryRamp, out + start, num);
         }
         JUCE_END_IGNORE_WARNINGS_MSVC
     }
 
-    /** Applies the reverb to a single mono channel of audio data. */
-    void processMono (float* const samples, const int numSamples) noexcept {
-        JUCE_BEGIN_IGNORE_WARNINGS_MSVC (6011)
-        jassert (samples != nullptr);
+    /** Applies the reverb to numChannels channels of audio data, e.g. a surround bed.
+
+        All channels are summed into one input, which feeds every channel's tank; the sum
+        is scaled by 2 / numChannels so a bed reverberates as loudly as a stereo pair at the
+        same level. Each channel's wet signal is crossfed with the mean of the others by the
+        width parameter, which for two channels is what processStereo() does.
 
-        for (int i = 0; i < numSamples; ++i) {
-            const float input = samples[i] * gain;
-            float output      = 0;
+        The outputs may be the inputs.
+    */
+    template <typename IOType>
+    void processChannels (const IOType* const* const inputs, IOType* const* const outputs, const int numSamples) noexcept {
+        jassert (inputs != nullptr && outputs != nullptr);
+
+        const SampleType inputGain = gain * SampleType (2.0 / numChannels);
+
+        const auto& mix = getMix<IOType>();
+        const bool parallel = processInParallel (
+            numSamples,
+            [&] (const int start, const int num, SampleType* const in) {
+                for (int i = 0; i < num; ++i)
+                    in[i] = SampleType (inputs[0][start + i]);
+
+                for (int c = 1; c < numChannels; ++c)
+                    for (int i = 0; i < num; ++i)
+                        in[i] += SampleType (inputs[c][start + i]);
+
+                for (int i = 0; i < num; ++i)
+                    in[i] *= inputGain;
+            },
+            [&] (const int start, const int num, const bool steady, SampleType* const* const wet, const SampleType* const* const ramps) {
+                const IOType* dry[numChannels];
+                IOType* out[numChannels];
+                for (int c = 0; c < numChannels; ++c) {
+                    dry[c] = inputs[c] + start;
+                    out[c] = outputs[c] + start;
+                }
+
+                (steady ? mix.steadyChannels : mix.channels) (wet, dry, ramps[wet1Slot], ramps[wet2Slot], ramps[drySlot], out, num);
+            });
+
+        for (int start = parallel ? numSamples : 0; start < numSamples; start += maxBlockSize) {
+            const int num = juce::jmin ((int) maxBlockSize, numSamples - start);
+
+            const IOType* in[numChannels];
+            IOType* out[numChannels];
+            SampleType* wet[numChannels];
+
+            for (int c = 0; c < numChannels; ++c) {
+                in[c]  = inputs[c] + start;
+                out[c] = outputs[c] + start;
+                wet[c] = wetOut[c];
+            }
 
-            const float damp    = damping.getNextValue();
-            const float feedbck = feedback.getNextValue();
+            for (int i = 0; i < num; ++i)
+                input[i] = SampleType (in[0][i]);
 
-            for (int j = 0; j < numCombs; ++j) // accumulate the comb filters in parallel
-                output += comb[0][j].process (input, damp, feedbck);
+            for (int c = 1; c < numChannels; ++c)
+                for (int i = 0; i < num; ++i)
+                    input[i] += SampleType (in[c][i]);
 
-            for (int j = 0; j < numAllPasses; ++j) // run the allpass filters in series
-                output = allPass[0][j].process (output);
+            for (int i = 0; i < num; ++i)
+                input[i] *= inputGain;
 
-            const float dry  = dryGain.getNextValue();
-            const float wet1 = wetGain1.getNextValue();
+            const bool steady = fillRamps (num);
+            runTank (num, steady, numChannels); // every channel's combs in parallel
 
-            samples[i] = output * wet1 + samples[i] * dry;
+            alignas (64) IOType delayed[numChannels][maxBlockSize];
+            const IOType* dry[numChannels];
+            for (int c = 0; c < numChannels; ++c)
+                dry[c] = delayDry (c, in[c], num, delayed[c]);
+
+            (steady ? mix.steadyChannels : mix.channels) (wet, dry, wet1Ramp, wet2Ramp, dryRamp, out, num);
         }
-        JUCE_END_IGNORE_WARNINGS_MSVC
     }
 
-private:
-    //==============================================================================
-    static bool isFrozen (const float freezeMode) noexcept { return freezeMode >= 0.5f; }
+    /** Applies the reverb to the sum of several stereo inputs, like a send bus where many
+        tracks share one room: the tank runs once however many inputs feed it.
+
+        Only the inputs with hasDry set pass their dry signal to the output, the others just
+        feed the tank. With one input this is processStereo(). The outputs may be any of the
+        inputs.
+    */
+    template <typename IOType>
+    void processBus (const IOType* const* const left,
+                     const IOType* const* const right,
+                     const bool* const hasDry,
+                     const int numInputs,
+                     IOType* const out1, IOType* const out2,
+                     const int numSamples) noexcept {
+        static_assert (numChannels == 2, "processBus needs a two channel engine");
+        jassert (left != nullptr && right != nullptr && hasDry != nullptr && numInputs > 0);
+
+        int numDry = 0, firstDry = 0;
+        for (int k = numInputs; --k >= 0;) {
+            if (hasDry[k]) {
+                ++numDry;
+                firstDry = k;
+            }
+        }
+
+        for (int start = 0; start < numSamples; start += maxBlockSize) {
+            const int num = juce::jmin ((int) maxBlockSize, numSamples - start);
+
+            for (int i = 0; i < num; ++i)
+                input[i] = SampleType (left[0][start + i] + right[0][start + i]);
+
+            for (int k = 1; k < numInputs; ++k)
+                for (int i = 0; i < num; ++i)
+                    input[i] += SampleType (left[k][start + i] + right[k][start + i]);
+
+            for (int i = 0; i < num; ++i)
+                input[i] *= gain;
+
+            // A single dry input is mixed straight from its buffers, more are summed first.
+            alignas (64) IOType drySum[2][maxBlockSize];
+            const IOType* dryL = drySum[0];
+            const IOType* dryR = drySum[1];
+
+            if (numDry == 1) {
+                dryL = left[firstDry] + start;
+                dryR = right[firstDry] + start;
+            } else {
+                std::fill_n (drySum[0], num, IOType());
+                std::fill_n (drySum[1], num, IOType());
+
+                for (int k = 0; k < numInputs; ++k) {
+                    if (hasDry[k]) {
+                        for (int i = 0; i < num; ++i) {
+                            drySum[0][i] += left[k][start + i];
+                            drySum[1][i] += right[k][start + i];
+                        }
+                    }
+                }
+            }
 
-    void updateDamping() noexcept {
-        const float roomScaleFactor = 0.28f;
-        const float roomOffset      = 0.7f;
-        const float dampScaleFactor = 0.4f;
+            const bool steady = fillRamps (num);
+            runTank (num, steady, numChannels);
 
-        if (isFrozen (parameters.freezeMode))
-            setDamping (0.0f, 1.0f);
+            alignas (64) IOType delayed[numChannels][maxBlockSize];
+            dryL = delayDry (0, dryL, num, delayed[0]);
+            dryR = delayDry (1, dryR, num, delayed[1]);
+
+            const auto& mix = getMix<IOType>();
+            (steady ? mix.steadyStereo : mix.stereo) (wetOut[0], wetOut[1], dryL, dryR, wet1Ramp, wet2Ramp, dryRamp, out1 + start, out2 + start, num);
+        }
+    }
+
+private:
+    //==============================================================================
+    template <typename IOType>
+    const typename KernelTable::template Mix<IOType>& getMix() const noexcept {
+        static_assert (std::is_same_v<IOType, float> || std::is_same_v<IOType, double>, "unsupported host sample type");
+        if constexpr (std::is_same_v<IOType, float>)
+            return kernels->mix32;
         else
-            setDamping (parameters.damping * dampScaleFactor,
-                        parameters.roomSize * roomScaleFactor + roomOffset);
+            return kernels->mix64;
     }
 
-    void setDamping (const float dampingToUse, const float roomSizeToUse) noexcept {
-        damping.setTargetValue (dampingToUse);
-        feedback.setTargetValue (roomSizeToUse);
+    /** Fills the per-sample coefficient ramps for the next numSamples. Once every value
+        has reached its target only the first entry of each ramp is written, and this
+        returns true so the steady kernels can run with constant coefficients.
+    */
+    bool fillRamps (const int numSamples) noexcept {
+        SampleType* const ramps[] = { dampRamp, feedbackRamp, dryRamp, wet1Ramp, wet2Ramp };
+        return fillRamps (numSamples, ramps);
     }
 
-    //==============================================================================
-    class CombFilter {
-    public:
-        CombFilter() noexcept {}
+    /** Same as fillRamps(), into ramps indexed by RampSlot. */
+    bool fillRamps (const int numSamples, SampleType* const* const ramps) noexcept {
+        const bool steady = ! (damping.isSmoothing() || feedback.isSmoothing() || dryGain.isSmoothing()
+                               || wetGain1.isSmoothing() || wetGain2.isSmoothing());
+        const int num     = steady ? 1 : numSamples;
+
+        damping.fill (ramps[dampSlot], num);
+        feedback.fill (ramps[feedbackSlot], num);
+        dryGain.fill (ramps[drySlot], num);
+        wetGain1.fill (ramps[wet1Slot], num);
+        wetGain2.fill (ramps[wet2Slot], num);
+        return steady;
+    }
 
-        void setSize (const int size) {
-            if (size != bufferSize) {
-                bufferIndex = 0;
-                buffer.malloc (size);
-                bufferSize = size;
+    /** Runs a host block with the tank split in two halves of the channels, one task of
+        taskPool each, see setTaskPool(). The input and the ramps of every slice are worked
+        out first, fillInput (start, num, input) giving the scaled input; after both halves
+        have run, mix (start, num, steady, wet, ramps) mixes each slice. Returns false,
+        without doing anything, for a block that runs on the calling thread.
+    */
+    template <typename FillInput, typename Mix>
+    bool processInParallel (const int numSamples, FillInput&& fillInput, Mix&& mix) noexcept {
+        if (taskPool == nullptr || blockCapacity == 0 || numSamples < minParallelSamples
+            || resampler.factor != 1 || lineScale.isSmoothing() || appliedScale != lineScale.getTargetValue())
+            return false;
+
+        // Blocks longer than the buffers go through in chunks of blockCapacity.
+        for (int done = 0; done < numSamples; done += blockCapacity) {
+            blockSamples = juce::jmin (blockCapacity, numSamples - done);
+
+            for (int start = 0, slice = 0; start < blockSamples; start += maxBlockSize, ++slice) {
+                const int num = juce::jmin ((int) maxBlockSize, blockSamples - start);
+
+                SampleType* ramps[numRampSlots];
+                for (int r = 0; r < numRampSlots; ++r)
+                    ramps[r] = blockSlot (r) + start;
+
+                fillInput (done + start, num, blockSlot (inputSlot) + start);
+                blockSteady[slice] = fillRamps (num, ramps);
+                lineScale.skip (num);
             }
 
-            clear();
-        }
+            if (! taskPool->run (&runHalfTask, this, 2)) {
+                runHalf (0);
+                runHalf (1);
+            }
 
-        void clear() noexcept {
-            last = 0;
-            buffer.clear ((size_t) bufferSize);
+            for (int start = 0, slice = 0; start < blockSamples; start += maxBlockSize, ++slice) {
+                const int num = juce::jmin ((int) maxBlockSize, blockSamples - start);
+
+                SampleType* ramps[numRampSlots];
+                for (int r = 0; r < numRampSlots; ++r)
+                    ramps[r] = blockSlot (r) + start;
+
+                SampleType* wet[numChannels];
+                for (int c = 0; c < numChannels; ++c)
+                    wet[c] = blockSlot (wetSlot + c) + start;
+
+                trackSilence (blockSlot (inputSlot) + start, wet, num, numChannels);
+                mix (done + start, num, blockSteady[slice], wet, ramps);
+            }
         }
 
-        float process (const float input, const float damp, const float feedbackLevel) noexcept {
-            const float output = buffer[bufferIndex];
-            last               = (output * (1.0f - damp)) + (last * damp);
-            JUCE_UNDENORMALISE (last);
+        return true;
+    }
+
+    static void runHalfTask (void* const context, const int half) noexcept {
+        // A pool thread has its own floating point mode, the caller's flush-to-zero doesn't
+        // reach it.
+        const juce::ScopedNoDenormals noDenormals;
+        static_cast<ReverbEngine*> (context)->runHalf (half);
+    }
+
+    /** Runs the combs and all-passes of half 0 or 1 of the channels over the block laid out
+        by processInParallel(). The halves share nothing they write, so may run at once.
+    */
+    void runHalf (const int half) noexcept {
+        const int firstChannel = half == 0 ? 0 : numChannels / 2;
+        const int endChannel   = half == 0 ? numChannels / 2 : numChannels;
+
+        for (int start = 0, slice = 0; start < blockSamples; start += maxBlockSize, ++slice) {
+            const int num     = juce::jmin ((int) maxBlockSize, blockSamples - start);
+            const bool steady = blockSteady[slice];
 
-            float temp = input + (last * feedbackLevel);
-            JUCE_UNDENORMALISE (temp);
-            buffer[bufferIndex] = temp;
-            bufferIndex         = (bufferIndex + 1) % bufferSize;
-            return output;
+            SampleType* wet[numChannels];
+            for (int c = 0; c < numChannels; ++c)
+                wet[c] = blockSlot (wetSlot + c) + start;
+
+            const auto& halves = network ? (steady ? kernels->steadyHalfNetwork : kernels->halfNetwork)
+                                         : (steady ? kernels->steadyHalfCombs : kernels->halfCombs);
+            halves[half] (combs.lanes, blockSlot (inputSlot) + start, blockSlot (dampSlot) + start, blockSlot (feedbackSlot) + start, wet, num);
+
+            for (int c = firstChannel; c < endChannel; ++c)
+                kernels->allPasses (allPasses[c].lines + firstAllPass(), numAllPasses - firstAllPass(), wet[c], num);
         }
+    }
 
-    private:
-        juce::HeapBlock<float> buffer;
-        int bufferSize = 0, bufferIndex = 0;
-        float last = 0.0f;
+    /** Sizes the buffers of processInParallel() for blocks of up to numSamples, in whole
+        slices and at most maxParallelBlock.
+    */
+    void reserveBlock (const int numSamples) {
+        const int numSlices = (juce::jmin ((int) maxParallelBlock, numSamples) + maxBlockSize - 1) / maxBlockSize;
+        blockCapacity       = numSlices * maxBlockSize;
+        blockStorage.malloc ((size_t) numBlockSlots * blockCapacity);
+        blockSteady.malloc ((size_t) juce::jmax (1, numSlices));
+    }
 
-        JUCE_DECLARE_NON_COPYABLE (CombFilter)
-    };
+    SampleType* blockSlot (const int slot) noexcept { return blockStorage.get() + (size_t) slot * blockCapacity; }
 
-    //==============================================================================
-    class AllPassFilter {
-    public:
-        AllPassFilter() noexcept {}
+    /** Runs the combs and all-passes of the first numRun channels, 1 or numChannels, over
+        numSamples of input and leaves each channel's wet signal in wetOut.
+
+        At a reduced tank rate the input is decimated first and the coefficient ramps thinned
+        to match. Interpolating the wet signals back gives whole frames of factor samples,
+        so up to factor - 1 of them are held back for the next block.
+    */
+    void runTank (const int numSamples, const bool steady, const int numRun) noexcept {
+        const SampleType scale = lineScale.skip (numSamples);
+        if (scale != appliedScale)
+            scaleLines (scale, false);
+
+        const int factor = resampler.factor;
+        SampleType* wet[numChannels];
+
+        if (factor == 1) {
+            for (int c = 0; c < numChannels; ++c)
+                wet[c] = wetOut[c];
+
+            runFilters (input, dampRamp, feedbackRamp, wet, numSamples, steady, numRun);
+            trackSilence (numSamples, numRun);
+            return;
+        }
+
+        const int numFrames = kernels->decimate (resampler, decimator, input, numSamples, tankInput);
 
-        void setSize (const int size) {
-            if (size != bufferSize) {
-                bufferIndex = 0;
-                buffer.malloc (size);
-                bufferSize = size;
+        if (! steady) {
+            for (int i = 0; i < numFrames; ++i) {
+                const int s     = juce::jmin (numSamples - 1, i * factor);
+                tankDamp[i]     = dampRamp[s];
+                tankFeedback[i] = feedbackRamp[s];
             }
+        }
+
+        for (int c = 0; c < numChannels; ++c)
+            wet[c] = tankWet[c];
+
+        runFilters (tankInput, steady ? dampRamp : tankDamp, steady ? feedbackRamp : tankFeedback, wet, numFrames, steady, numRun);
+
+        // A block shorter than the frames held back only takes the first of them, and the
+        // rest move to the front for the next.
+        const int numRaised = numFrames * factor;
+        const int numOld    = juce::jmin (numSamples, numCarried);
+        const int numFresh  = numSamples - numOld;
+        const int numKept   = numCarried - numOld;
 
-            clear();
+        for (int c = 0; c < numRun; ++c) {
+            kernels->interpolate (resampler, interpolators[c], tankWet[c], numFrames, raised);
+            std::copy_n (carried[c], numOld, wetOut[c]);
+            std::copy_n (raised, numFresh, wetOut[c] + numOld);
+            std::memmove (carried[c], carried[c] + numOld, sizeof (SampleType) * (size_t) numKept);
+            std::copy (raised + numFresh, raised + numRaised, carried[c] + numKept);
         }
 
-        void clear() noexcept {
-            buffer.clear ((size_t) bufferSize);
+        numCarried = numKept + numRaised - numFresh;
+        trackSilence (numSamples, numRun);
+    }
+
+    /** Counts the samples the tank's input has been silent and its output quiet for, see
+        isTailSilent(). The input is already scaled by gain, which is 0 while frozen.
+    */
+    void trackSilence (const int numSamples, const int numRun) noexcept {
+        SampleType* wet[numChannels];
+        for (int c = 0; c < numChannels; ++c)
+            wet[c] = wetOut[c];
+
+        trackSilence (input, wet, numSamples, numRun);
+    }
+
+    void trackSilence (const SampleType* const in, SampleType* const* const wet, const int numSamples, const int numRun) noexcept {
+        constexpr SampleType threshold = SampleType (1.0e-5); // -100 dB
+
+        bool quiet = peak (in, numSamples) <= threshold * gain;
+        for (int c = 0; c < numRun && quiet; ++c)
+            quiet = peak (wet[c], numSamples) <= threshold;
+
+        quietSamples = quiet ? juce::jmin (quietSamples + numSamples, (int) silentForever) : 0;
+    }
+
+    /** Returns the largest magnitude of numSamples. Each lane of the accumulator only sees
+        every numLanes-th sample, so the loop vectorizes without reordering any comparison.
+    */
+    static SampleType peak (const SampleType* const samples, const int numSamples) noexcept {
+        constexpr int numLanes = 16;
+        SampleType lanes[numLanes] {};
+
+        int i = 0;
+        for (; i + numLanes <= numSamples; i += numLanes)
+            for (int k = 0; k < numLanes; ++k)
+                lanes[k] = juce::jmax (lanes[k], std::abs (samples[i + k]));
+
+        for (; i < numSamples; ++i)
+            lanes[0] = juce::jmax (lanes[0], std::abs (samples[i]));
+
+        return *std::max_element (lanes, lanes + numLanes);
+    }
+
+    /** Reads every delay line scale times its length behind the write head, see
+        ReverbParameters::size. Unless now is set, the kernels move each read tap there over
+        the next block.
+    */
+    void scaleLines (const SampleType scale, const bool now) noexcept {
+        auto& lanes = combs.lanes;
+        for (int j = 0; j < numChannels * numCombs; ++j) {
+            lanes.target[j] = juce::jlimit (1, lanes.size[j], juce::roundToInt (lanes.size[j] * scale));
+            if (now)
+                lanes.delay[j] = lanes.target[j];
         }
 
-        float process (const float input) noexcept {
-            const float bufferedValue = buffer[bufferIndex];
-            float temp                = input + (bufferedValue * 0.5f);
-            JUCE_UNDENORMALISE (temp);
-            buffer[bufferIndex] = temp;
-            bufferIndex         = (bufferIndex + 1) % bufferSize;
-            return bufferedValue - input;
+        for (auto& chain : allPasses) {
+            for (auto& line : chain.lines) {
+                line.target = juce::jlimit (1, line.size, juce::roundToInt (line.size * scale));
+                if (now)
+                    line.delay = line.target;
+            }
         }
 
-    private:
-        juce::HeapBlock<float> buffer;
-        int bufferSize = 0, bufferIndex = 0;
+        appliedScale = scale;
+    }
 
-        JUCE_DECLARE_NON_COPYABLE (AllPassFilter)
-    };
+    void runFilters (const SampleType* const in,
+                     const SampleType* const damp,
+                     const SampleType* const feedbackLevel,
+                     SampleType* const* const wet,
+                     const int numSamples,
+                     const bool steady,
+                     const int numRun) noexcept {
+        if (numRun == 1) {
+            if (network)
+                (steady ? kernels->steadyFirstNetwork : kernels->firstNetwork) (combs.lanes, in, damp, feedbackLevel, wet[0], numSamples);
+            else
+                (steady ? kernels->steadyFirstCombs : kernels->firstCombs) (combs.lanes, in, damp, feedbackLevel, wet[0], numSamples);
+        } else {
+            if (network)
+                (steady ? kernels->steadyNetwork : kernels->network) (combs.lanes, in, damp, feedbackLevel, wet, numSamples);
+            else
+                (steady ? kernels->steadyCombs : kernels->combs) (combs.lanes, in, damp, feedbackLevel, wet, numSamples);
+        }
 
-    //==============================================================================
-    enum { numCombs     = 8,
-           numAllPasses = 4,
-           numChannels  = 2 };
+        for (int c = 0; c < numRun; ++c)
+            kernels->allPasses (allPasses[c].lines + firstAllPass(), numAllPasses - firstAllPass(), wet[c], numSamples); // run the allpass filters in series
+    }
 
-    Parameters parameters;
-    float gain;
+    /** Returns the first all-pass of each chain the tank runs: all of them for the combs,
+        only the two shortest for the network.
+    */
+    int firstAllPass() const noexcept {
+        return network ? firstNetworkAllPass : 0;
+    }
 
-    CombFilter comb[numChannels][numCombs];
-    AllPassFilter allPass[numChannels][numAllPasses];
+    /** Returns a channel's dry input lined up with its wet signal: dry itself at the host
+        rate, otherwise a copy in scratch delayed by getLatencySamples(). The delay line
+        holds doubles, so a 64-bit host's dry path keeps its precision.
+    */
+    template <typename IOType>
+    const IOType* delayDry (const int channel, const IOType* const dry, const int numSamples, IOType* const scratch) noexcept {
+        if (resampler.factor == 1)
+            return dry;
 
-    juce::SmoothedValue<float> damping, feedback, dryGain, wetGain1, wetGain2;
+        double* const line = dryLines[channel];
+        const int latency  = getLatencySamples();
 
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Reverb)
-};
-} // namespace everb
\ No newline at end of file
+        for (int i = 0; i < numSamples; ++i)
+            line[latency + i] = dry[i];
+
+        for (int i = 0; i < numSamples; ++i)
+            scratch[i] = IOType (line[i]);
+
+        std::copy_n (line + numSamples, latency, line);
+        return scratch;
+    }
+
+    void clearResampler() noexcept {
+        decimator = DecimatorState<SampleType>();
+        for (auto& interpolator : interpolators)
+            interpolator = InterpolatorState<SampleType>();
+
+        std::fill_n (&carried[0][0], numChannels * Taps::maxFactor, SampleType());
+        numCarried = resampler.factor - 1;
+
+        std::fill_n (&dryLines[0][0], numChannels * dryLineSize, 0.0);
+    }
+
+    /** Designs linear phase low-pass filters cutting off at half the reduced rate, as
+        Kaiser windowed sincs. With beta 6 they reject around 60 dB outside a transition
+        band of an eighth of the reduced rate either side of the cutoff, which leaves a
+        48 kHz tank flat to 18 kHz; a reverb's damped tail has little above that.
+    */
+    static void designResampler (Taps& taps, const int factor) noexcept {
+        jassert (factor == 1 || factor == 2 || factor == Taps::maxFactor);
+        taps.factor = factor;
+
+        constexpr double beta = 6.0;
+        const auto bessel     = [] (const double x) { // zeroth order modified Bessel function of the first kind
+            double sum = 1.0, term = 1.0;
+            for (int k = 1; k < 32; ++k) {
+                term *= (x / (2 * k)) * (x / (2 * k));
+                sum += term;
+            }
+            return sum;
+        };
+
+        const int numTaps     = factor * Taps::tapsPerPhase;
+        const double centre   = (numTaps - 1) / 2.0;
+        const double cutoff   = 0.5 / factor;
+        double h[Taps::maxFactor * Taps::tapsPerPhase], sum = 0;
+
+        for (int k = 0; k < numTaps; ++k) {
+            const double t      = k - centre;
+            const double x      = juce::MathConstants<double>::pi * 2 * cutoff * t;
+            const double r      = t / centre;
+            const double window = bessel (beta * std::sqrt (juce::jmax (0.0, 1 - r * r))) / bessel (beta);
+            h[k]                = (x == 0 ? 1.0 : std::sin (x) / x) * window;
+            sum += h[k];
+        }
+
+        // Unity gain at DC: the decimator over all taps, the interpolator for each phase.
+        for (int p = 0; p < factor; ++p) {
+            for (int j = 0; j < Taps::tapsPerPhase; ++j) {
+                taps.down[p][j] = SampleType (h[j * factor + factor - 1 - p] / sum);
+                taps.up[p][j]   = SampleType (h[j * factor + p] * factor / sum);
+            }
+        }
+    }
+
+    //==============================================================================
+    /** A linear parameter ramp with the behaviour of juce::SmoothedValue, produced a
+        block at a time so that filling a ramp is a single vectorizable loop.
+    */
+    class LinearSmoother {
+    public:
+        void reset (const double sampleRate, const double rampLengthInSeconds) noexcept {
+            jassert (sampleRate > 0 && rampLengthInSeconds >= 0);
+            stepsToTarget = (int) std::floor (rampLengthInSeconds * sampleRate);
+            current       = target;
+            countdown     = 0;
+        }
+
+        void setTargetValue (const SampleType newValue) noexcept {
+            if (newValue == target)
+                return;
+
+            target = newValue;
+
+            if (stepsToTarget <= 0) {
+                current   = target;
+                countdown = 0;
+                return;
+            }
+
+            countdown = stepsToTarget;
+            step      = (target - current) / (SampleType) countdown;
+        }
+
+        bool isSmoothing() const noexcept { return countdown > 0; }
+        SampleType getTargetValue() const noexcept { return target; }
+
+        /** Writes the next numSamples values into ramp and advances past them. */
+        void fill (SampleType* const ramp, const int numSamples) noexcept {
+            const int numRamped = juce::jmin (numSamples, countdown);
+
+            for (int i = 0; i < numRamped; ++i)
+                ramp[i] = current + step * (SampleType) (i + 1);
+
+            for (int i = numRamped; i < numSamples; ++i)
+                ramp[i] = target;
+
+            countdown -= numRamped;
+            if (countdown > 0) {
+                current += step * (SampleType) numRamped;
+            } else {
+                current = target;
+                if (numRamped > 0)
+                    ramp[numRamped - 1] = target;
+            }
+        }
+
+        /** Advances past the next numSamples values and returns the last of them. */
+        SampleType skip (const int numSamples) noexcept {
+            const int numRamped = juce::jmin (numSamples, countdown);
+            countdown -= numRamped;
+            current = countdown > 0 ? current + step * (SampleType) numRamped : target;
+            return current;
+        }
+
+    private:
+        SampleType current = 0, target = 0, step = 0;
+        int countdown = 0, stepsToTarget = 0;
+    };
+
+    //==============================================================================
+    /** A bank of comb filters held as a structure of arrays.
+
+        Every comb in the bank is stepped in the same pass, so the damping and feedback
+        arithmetic runs across vector lanes instead of once per filter. Lanes are laid out
+        channel-major: lanes [0, numCombs) belong to the first channel, the next numCombs
+        lanes to the second, and so on.
+
+        Each lane computes exactly what a single FreeVerb comb does. The only difference to
+        the scalar topology is the order in which lane outputs are summed (a pairwise tree
+        instead of left to right), which keeps the output within 1e-6 of it at full scale.
+    */
+    template <int numLanes>
+    class CombBank {
+    public:
+        CombBank() noexcept {}
+
+        /** Points a lane at its delay memory, which must hold size samples, and reads it
+            size samples behind the write head.
+        */
+        void setLine (const int lane, StorageType* const buffer, const int size) noexcept {
+            jassert (juce::isPositiveAndBelow (lane, numLanes) && size > 0);
+            lanes.buffer[lane] = buffer;
+            lanes.size[lane]   = size;
+            lanes.delay[lane]  = size;
+            lanes.target[lane] = size;
+            clear (lane);
+        }
+
+        /** Silences a lane in constant time: its memory is zeroed by the kernels as the
+            write head gets to it, which happens before anything there is read.
+        */
+        void clear (const int lane) noexcept {
+            lanes.last[lane]  = 0;
+            lanes.index[lane] = 0;
+            lanes.stale[lane] = 1;
+        }
+
+        void clear() noexcept {
+            for (int i = 0; i < numLanes; ++i)
+                clear (i);
+        }
+
+        CombLanes<SampleType, numLanes, StorageType> lanes;
+
+    private:
+        JUCE_DECLARE_NON_COPYABLE (CombBank)
+    };
+
+    //==============================================================================
+    /** The series all-pass filters of one channel. */
+    class AllPassChain {
+    public:
+        AllPassChain() noexcept {}
+
+        /** Points a stage at its delay memory, which must hold size samples, and reads it
+            size samples behind the write head.
+        */
+        void setLine (const int stage, StorageType* const buffer, const int size) noexcept {
+            jassert (juce::isPositiveAndBelow (stage, numAllPasses) && size > 0);
+            lines[stage].buffer = buffer;
+            lines[stage].size   = size;
+            lines[stage].delay  = size;
+            lines[stage].target = size;
+            clear (stage);
+        }
+
+        /** Silences a stage in constant time, like CombBank::clear(). */
+        void clear (const int stage) noexcept {
+            lines[stage].index = 0;
+            lines[stage].stale = true;
+        }
+
+        void clear() noexcept {
+            for (int i = 0; i < numAllPasses; ++i)
+                clear (i);
+        }
+
+        AllPassLine<StorageType> lines[numAllPasses];
+
+    private:
+        JUCE_DECLARE_NON_COPYABLE (AllPassChain)
+    };
+
+    //==============================================================================
+    /** The delay line lengths at a sample rate, and the arena space they take up. */
+    struct LineSizes {
+        explicit LineSizes (const double sampleRate) noexcept {
+            constexpr auto combTunings    = Tunings::combs(); // (at 44100Hz)
+            constexpr auto allPassTunings = Tunings::allPasses();
+            constexpr auto spreads        = Tunings::template spreads<numChannels>();
+
+            for (int c = 0; c < numChannels; ++c) {
+                for (int i = 0; i < numCombs; ++i) {
+                    combs[c][i] = Tunings::scale (combTunings[i] + spreads[c], sampleRate);
+                    total += DelayArena<StorageType>::paddedSize (combs[c][i]);
+                }
+
+                for (int i = 0; i < numAllPasses; ++i) {
+                    allPasses[c][i] = Tunings::scale (allPassTunings[i] + spreads[c], sampleRate);
+                    total += DelayArena<StorageType>::paddedSize (allPasses[c][i]);
+                }
+            }
+        }
+
+        int combs[numChannels][numCombs], allPasses[numChannels][numAllPasses];
+        size_t total = 0;
+    };
+
+    //==============================================================================
+    enum { maxBlockSize = 256, dryLineSize = Taps::maxFactor * Taps::tapsPerPhase + maxBlockSize, silentForever = 1 << 30 };
+    static_assert (maxBlockSize <= Taps::maxInput, "the decimator takes a block at a time");
+
+    // The buffers of processInParallel(), each blockCapacity samples: the coefficient ramps
+    // as fillRamps() takes them, then the input and every channel's wet signal.
+    enum RampSlot { dampSlot, feedbackSlot, drySlot, wet1Slot, wet2Slot, numRampSlots };
+    enum { inputSlot = numRampSlots, wetSlot, numBlockSlots = wetSlot + numChannels, maxParallelBlock = 16 * maxBlockSize };
+
+    // The network runs the all-passes from this one on, the two shortest.
+    enum { firstNetworkAllPass = numAllPasses > 2 ? numAllPasses - 2 : 0 };
+
+    Parameters parameters;
+    SampleType gain;
+    bool network = false;
+    const KernelTable* kernels = &KernelTable::baseline();
+
+    CombBank<numChannels * numCombs> combs;
+    AllPassChain allPasses[numChannels];
+    DelayArena<StorageType> arena;
+    StorageType* delayMemory = nullptr; // see setDelayMemory()
+
+    LinearSmoother damping, feedback, dryGain, wetGain1, wetGain2, lineScale;
+    SampleType appliedScale = 1;
+    int quietSamples        = silentForever;
+
+    alignas (64) SampleType input[maxBlockSize], wetOut[numChannels][maxBlockSize];
+    alignas (64) SampleType dampRamp[maxBlockSize], feedbackRamp[maxBlockSize];
+    alignas (64) SampleType dryRamp[maxBlockSize], wet1Ramp[maxBlockSize], wet2Ramp[maxBlockSize];
+
+    // The reduced tank rate, see setMinTankRate().
+    double minTankRate = 0;
+    Taps resampler;
+    DecimatorState<SampleType> decimator;
+    InterpolatorState<SampleType> interpolators[numChannels];
+    alignas (64) SampleType tankInput[Taps::maxFrames], tankDamp[Taps::maxFrames], tankFeedback[Taps::maxFrames];
+    alignas (64) SampleType tankWet[numChannels][Taps::maxFrames], raised[maxBlockSize + Taps::maxFactor];
+    SampleType carried[numChannels][Taps::maxFactor];
+    int numCarried = 0;
+    double dryLines[numChannels][dryLineSize];
+
+    // Running the halves of the tank at once, see setTaskPool().
+    TaskPool* taskPool     = nullptr;
+    int minParallelSamples = 1;
+    int blockCapacity = 0, blockSamples = 0;
+    juce::HeapBlock<SampleType> blockStorage;
+    juce::HeapBlock<bool> blockSteady;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ReverbEngine)
+};
+
+//==============================================================================
+/** The FreeVerb stereo reverb: 8 combs and 4 all-passes per channel, in float. */
+using Reverb = ReverbEngine<8, 4, 2, float>;
+
+/** The FreeVerb stereo reverb with 64-bit delay lines. */
+using Reverb64 = ReverbEngine<8, 4, 2, double>;
+
+/** The FreeVerb stereo reverb with half precision delay lines, for half the memory of
+    Reverb. The extra noise stays around 65 dB below the wet signal.
+*/
+using ReverbCompact = ReverbEngine<8, 4, 2, float, Half>;
+
+#ifndef EVERB_HALF_DELAYS
+#    define EVERB_HALF_DELAYS 0
+#endif
+
+/** What the plugins' delay lines hold, chosen with the delay_storage build option. */
+using PluginStorage = std::conditional_t<EVERB_HALF_DELAYS, Half, float>;
+
+/** The FreeVerb engine the plugins run for a channel count. */
+template <int numChannels>
+using PluginEngine = ReverbEngine<8, 4, numChannels, float, PluginStorage>;
+
+/** The stereo engine the plugins run. */
+using PluginReverb = PluginEngine<2>;
+
+//==============================================================================
+/**
+    Runs numLanes independent stereo reverbs of one topology side by side, one reverb in
+    each vector lane.
+
+    Every reverb in the bank has its own parameters, input and output. They share the
+    sample rate, so their delay lines have the same lengths and are stepped together: the
+    lines are interleaved, and one sample of every reverb takes the instructions a single
+    reverb would. With AVX2 or AVX-512 kernels, 8 or 16 reverbs cost little more than one.
+
+    Each lane computes what a stereo ReverbEngine of the same topology computes with the
+    same parameters, except that the comb outputs are summed in a different order. The bank
+    only runs combs at their full lengths, so it ignores ReverbParameters::network and
+    ReverbParameters::size.
+
+    @see ReverbBank, ReverbEngine
+
+    @tags{Audio}
+*/
+template <int numCombs, int numAllPasses, int numLanes, typename SampleType>
+class ReverbBankEngine {
+public:
+    static_assert (numLanes > 0 && numLanes <= 64 && (numLanes & (numLanes - 1)) == 0, "lanes fill whole vectors");
+
+    using Parameters   = ReverbParameters;
+    using KernelTable  = BankKernels<numCombs, numLanes, SampleType>;
+    using Tunings      = ReverbTunings<numCombs, numAllPasses>;
+    using Coefficients = ReverbCoefficients<SampleType, numCombs>;
+
+    //==============================================================================
+    ReverbBankEngine() {
+        setParameters (Parameters());
+        setSampleRate (44100.0);
+    }
+
+    //==============================================================================
+    /** Chooses the processing kernels, e.g. KernelTable::best(). Until this is called the
+        bank uses KernelTable::baseline(). Don't call this in parallel with processing.
+    */
+    void setKernels (const KernelTable& newKernels) noexcept { kernels = &newKernels; }
+
+    /** Returns the processing kernels in use, see BankKernels::name. */
+    const KernelTable& getKernels() const noexcept { return *kernels; }
+
+    /** Returns the number of reverbs in the bank. */
+    static constexpr int getNumLanes() noexcept { return numLanes; }
+
+    //==============================================================================
+    /** Returns the current parameters of one reverb in the bank. */
+    const Parameters& getParameters (const int lane) const noexcept {
+        jassert (juce::isPositiveAndBelow (lane, numLanes));
+        return parameters[lane];
+    }
+
+    /** Applies a new set of parameters to one reverb in the bank. Like
+        ReverbEngine::setParameters(), this doesn't lock against processing.
+    */
+    void setParameters (const int lane, const Parameters& newParams) noexcept {
+        jassert (juce::isPositiveAndBelow (lane, numLanes));
+
+        const Coefficients c (newParams);
+        dryGain.setTargetValue (lane, c.dry);
+        wetGain1.setTargetValue (lane, c.wet1);
+        wetGain2.setTargetValue (lane, c.wet2);
+        damping.setTargetValue (lane, c.damping);
+        feedback.setTargetValue (lane, c.feedback);
+
+        gain[lane]       = c.gain;
+        parameters[lane] = newParams;
+    }
+
+    /** Applies the same parameters to every reverb in the bank. */
+    void setParameters (const Parameters& newParams) noexcept {
+        for (int lane = 0; lane < numLanes; ++lane)
+            setParameters (lane, newParams);
+    }
+
+    //==============================================================================
+    /** Reserves the delay memory for every sample rate up to maxSampleRate, and sets the
+        sample rate to it, like ReverbEngine::prepare().
+    */
+    void prepare (const double maxSampleRate, const int maxBlockSize) {
+        jassert (maxSampleRate > 0);
+        juce::ignoreUnused (maxBlockSize);
+
+        const LineSizes sizes (maxSampleRate);
+        arena.reserve (sizes.total);
+        setSampleRate (maxSampleRate);
+    }
+
+    /** Sets the sample rate of every reverb in the bank. This only allocates when the rate
+        is higher than any this bank was prepared for.
+    */
+    void setSampleRate (const double sampleRate) {
+        jassert (sampleRate > 0);
+
+        const LineSizes sizes (sampleRate);
+        SampleType* next = arena.allocate (sizes.total);
+
+        for (int c = 0; c < numChannels; ++c) {
+            for (int i = 0; i < numCombs; ++i) {
+                setLine (combs[c].lines[i], next, sizes.combs[c][i]);
+                next += DelayArena<SampleType>::paddedSize (sizes.combs[c][i] * numLanes);
+            }
+
+            for (int i = 0; i < numAllPasses; ++i) {
+                setLine (allPasses[c][i], next, sizes.allPasses[c][i]);
+                next += DelayArena<SampleType>::paddedSize (sizes.allPasses[c][i] * numLanes);
+            }
+        }
+
+        clearFilters();
+
+        const double smoothTime = 0.01;
+        damping.reset (sampleRate, smoothTime);
+        feedback.reset (sampleRate, smoothTime);
+        dryGain.reset (sampleRate, smoothTime);
+        wetGain1.reset (sampleRate, smoothTime);
+        wetGain2.reset (sampleRate, smoothTime);
+    }
+
+    /** Returns the number of bytes this bank occupies, delay lines included. */
+    size_t getMemoryUsage() const noexcept {
+        return sizeof (*this) + arena.getNumBytes();
+    }
+
+    /** Clears every reverb's buffers, in constant time like ReverbEngine::reset(). */
+    void reset() {
+        for (int c = 0; c < numChannels; ++c) {
+            for (auto& line : combs[c].lines)
+                clear (line);
+
+            for (auto& line : allPasses[c])
+                clear (line);
+        }
+
+        clearFilters();
+    }
+
+    //==============================================================================
+    /** Applies each reverb to its own stereo pair. Every argument but numSamples holds
+        numLanes channel pointers, one for each reverb; the outputs may be the inputs.
+
+        Like ReverbEngine::processStereo(), call this with flush-to-zero enabled.
+    */
+    template <typename IOType>
+    void processStereo (const IOType* const* const left,
+                        const IOType* const* const right,
+                        IOType* const* const out1, IOType* const* const out2,
+                        const int numSamples) noexcept {
+        jassert (left != nullptr && right != nullptr && out1 != nullptr && out2 != nullptr);
+
+        for (int start = 0; start < numSamples; start += maxBlockSize) {
+            const int num = juce::jmin ((int) maxBlockSize, numSamples - start);
+
+            const IOType* inL[numLanes];
+            const IOType* inR[numLanes];
+            IOType* outL[numLanes];
+            IOType* outR[numLanes];
+
+            for (int k = 0; k < numLanes; ++k) {
+                inL[k]  = left[k] + start;
+                inR[k]  = right[k] + start;
+                outL[k] = out1[k] + start;
+                outR[k] = out2[k] + start;
+            }
+
+            const auto& mix = getMix<IOType>();
+            mix.input (inL, inR, gain, input, num);
+
+            const bool steady = fillRamps (num);
+
+            for (int c = 0; c < numChannels; ++c) {
+                (steady ? kernels->steadyCombs : kernels->combs) (combs[c], input, dampRamp, feedbackRamp, wetOut[c], num);
+                kernels->allPasses (allPasses[c], numAllPasses, wetOut[c], num);
+            }
+
+            (steady ? mix.steadyStereo : mix.stereo) (wetOut[0], wetOut[1], inL, inR, wet1Ramp, wet2Ramp, dryRamp, outL, outR, num);
+        }
+    }
+
+private:
+    //==============================================================================
+    enum { numChannels = 2 };
+
+    /** Frames per internal slice, so the interleaved scratch buffers stay the same size
+        whatever the lane count.
+    */
+    enum { maxBlockSize = 1024 / numLanes };
+
+    using Line = typename KernelTable::Line;
+
+    static void setLine (Line& line, SampleType* const buffer, const int size) noexcept {
+        jassert (size > 0);
+        line.buffer = buffer;
+        line.size   = size;
+        clear (line);
+    }
+
+    /** Silences a line in constant time, like ReverbEngine::reset(). */
+    static void clear (Line& line) noexcept {
+        line.index = 0;
+        line.stale = true;
+    }
+
+    template <typename IOType>
+    const typename KernelTable::template Mix<IOType>& getMix() const noexcept {
+        static_assert (std::is_same_v<IOType, float> || std::is_same_v<IOType, double>, "unsupported host sample type");
+        if constexpr (std::is_same_v<IOType, float>)
+            return kernels->mix32;
+        else
+            return kernels->mix64;
+    }
+
+    void clearFilters() noexcept {
+        for (auto& bank : combs)
+            for (auto& lanes : bank.last)
+                for (auto& last : lanes)
+                    last = 0;
+    }
+
+    /** Fills the interleaved coefficient ramps for the next numFrames, like
+        ReverbEngine::fillRamps().
+    */
+    bool fillRamps (const int numFrames) noexcept {
+        const bool steady = ! (damping.isSmoothing() || feedback.isSmoothing() || dryGain.isSmoothing()
+                               || wetGain1.isSmoothing() || wetGain2.isSmoothing());
+        const int num     = steady ? 1 : numFrames;
+
+        damping.fill (dampRamp, num);
+        feedback.fill (feedbackRamp, num);
+        dryGain.fill (dryRamp, num);
+        wetGain1.fill (wet1Ramp, num);
+        wetGain2.fill (wet2Ramp, num);
+        return steady;
+    }
+
+    //==============================================================================
+    /** A linear ramp for each lane, with the behaviour of ReverbEngine's smoother, filled
+        into interleaved frames.
+    */
+    class LaneSmoother {
+    public:
+        void reset (const double sampleRate, const double rampLengthInSeconds) noexcept {
+            jassert (sampleRate > 0 && rampLengthInSeconds >= 0);
+            stepsToTarget = (int) std::floor (rampLengthInSeconds * sampleRate);
+
+            for (int k = 0; k < numLanes; ++k) {
+                current[k]   = target[k];
+                countdown[k] = 0;
+            }
+        }
+
+        void setTargetValue (const int lane, const SampleType newValue) noexcept {
+            if (newValue == target[lane])
+                return;
+
+            target[lane] = newValue;
+
+            if (stepsToTarget <= 0) {
+                current[lane]   = target[lane];
+                countdown[lane] = 0;
+                return;
+            }
+
+            countdown[lane] = stepsToTarget;
+            step[lane]      = (target[lane] - current[lane]) / (SampleType) stepsToTarget;
+        }
+
+        bool isSmoothing() const noexcept {
+            int any = 0;
+            for (int k = 0; k < numLanes; ++k)
+                any |= countdown[k];
+            return any != 0;
+        }
+
+        /** Writes the next numFrames frames into ramp and advances past them. A lane's
+            last ramped value is snapped to its target.
+        */
+        void fill (SampleType* const ramp, const int numFrames) noexcept {
+            for (int i = 0; i < numFrames; ++i)
+                for (int k = 0; k < numLanes; ++k)
+                    ramp[i * numLanes + k] = i < countdown[k] - 1 ? current[k] + step[k] * (SampleType) (i + 1)
+                                                                   : target[k];
+
+            for (int k = 0; k < numLanes; ++k) {
+                const int numRamped = juce::jmin (numFrames, countdown[k]);
+                countdown[k] -= numRamped;
+                current[k] = countdown[k] > 0 ? current[k] + step[k] * (SampleType) numRamped : target[k];
+            }
+        }
+
+    private:
+        alignas (64) SampleType current[numLanes] {}, target[numLanes] {}, step[numLanes] {};
+        alignas (64) int countdown[numLanes] {};
+        int stepsToTarget = 0;
+    };
+
+    //==============================================================================
+    /** The delay line lengths at a sample rate, and the arena space their interleaved
+        lanes take up.
+    */
+    struct LineSizes {
+        explicit LineSizes (const double sampleRate) noexcept {
+            constexpr auto combTunings    = Tunings::combs();
+            constexpr auto allPassTunings = Tunings::allPasses();
+            constexpr auto spreads        = Tunings::template spreads<numChannels>();
+
+            for (int c = 0; c < numChannels; ++c) {
+                for (int i = 0; i < numCombs; ++i) {
+                    combs[c][i] = Tunings::scale (combTunings[i] + spreads[c], sampleRate);
+                    total += DelayArena<SampleType>::paddedSize (combs[c][i] * numLanes);
+                }
+
+                for (int i = 0; i < numAllPasses; ++i) {
+                    allPasses[c][i] = Tunings::scale (allPassTunings[i] + spreads[c], sampleRate);
+                    total += DelayArena<SampleType>::paddedSize (allPasses[c][i] * numLanes);
+                }
+            }
+        }
+
+        int combs[numChannels][numCombs], allPasses[numChannels][numAllPasses];
+        size_t total = 0;
+    };
+
+    //==============================================================================
+    Parameters parameters[numLanes];
+    alignas (64) SampleType gain[numLanes] {};
+    const KernelTable* kernels = &KernelTable::baseline();
+
+    typename KernelTable::Combs combs[numChannels];
+    Line allPasses[numChannels][numAllPasses];
+    DelayArena<SampleType> arena;
+
+    LaneSmoother damping, feedback, dryGain, wetGain1, wetGain2;
+
+    alignas (64) SampleType input[maxBlockSize * numLanes], wetOut[numChannels][maxBlockSize * numLanes];
+    alignas (64) SampleType dampRamp[maxBlockSize * numLanes], feedbackRamp[maxBlockSize * numLanes];
+    alignas (64) SampleType dryRamp[maxBlockSize * numLanes], wet1Ramp[maxBlockSize * numLanes], wet2Ramp[maxBlockSize * numLanes];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ReverbBankEngine)
+};
+
+/** A bank of numLanes FreeVerb stereo reverbs in float, see ReverbBankEngine. Banks of 4,
+    8 and 16 lanes have kernels built.
+*/
+template <int numLanes>
+using ReverbBank = ReverbBankEngine<8, 4, numLanes, float>;
+
+//==============================================================================
+/** The quality tiers of a TieredReverb, as values of ReverbParameters::quality. */
+enum class ReverbQuality {
+    eco      = 0, /**< 4 combs and 2 all-passes per channel, for previews and monitoring. */
+    standard = 1, /**< FreeVerb's 8 combs and 4 all-passes. */
+    dense    = 2  /**< 16 combs and 6 all-passes, a smoother tail for a main bus. */
+};
+
+/**
+    A reverb whose topology follows ReverbParameters::quality, switchable while it runs.
+
+    Every tier is a ReverbEngine of its own, all prepared up front so that switching never
+    allocates. They share one block of delay memory: the tier running holds one end of it
+    and a tier fading in takes the other, so it only needs room for the two largest tiers,
+    not all three. A switch crossfades from the old tier to the new one over crossfadeSeconds,
+    running both until the fade ends. The new tier starts out empty, so its tail builds up
+    under the fade instead of cutting in; the dry path is the same in both and comes
+    through the fade unchanged.
+
+    Tiers are built for one and two channels, in float.
+
+    @see ReverbEngine, ReverbQuality
+
+    @tags{Audio}
+*/
+template <int numChannels, typename StorageType = float>
+class TieredReverb {
+public:
+    using Parameters = ReverbParameters;
+
+    template <int numCombs, int numAllPasses>
+    using Tier = ReverbEngine<numCombs, numAllPasses, numChannels, float, StorageType>;
+
+    using Eco      = Tier<4, 2>;
+    using Standard = Tier<8, 4>;
+    using Dense    = Tier<16, 6>;
+
+    /** How long a switch between tiers takes. */
+    static constexpr double crossfadeSeconds = 0.05;
+
+    //==============================================================================
+    TieredReverb() {
+        setSampleRate (44100.0);
+    }
+
+    //==============================================================================
+    /** Chooses each tier's KernelTable::best(). Until this is called they use baseline(). */
+    void useBestKernels() noexcept {
+        eco.setKernels (Eco::KernelTable::best());
+        standard.setKernels (Standard::KernelTable::best());
+        dense.setKernels (Dense::KernelTable::best());
+    }
+
+    /** Returns the name of the kernels in use, which is the same for every tier. */
+    const char* getKernelName() const noexcept { return standard.getKernels().name; }
+
+    //==============================================================================
+    /** Returns the reverb's current parameters. */
+    const Parameters& getParameters() const noexcept { return standard.getParameters(); }
+
+    /** Applies a new set of parameters, crossfading to another tier if the quality changed.
+        The fade starts with the next process call. During a fade, going back to the tier
+        fading out turns the fade around from where it is, and a third tier waits for the
+        fade to finish, so every tier's gain keeps gliding. Like
+        ReverbEngine::setParameters(), this doesn't lock against processing.
+    */
+    void setParameters (const Parameters& newParams) {
+        eco.setParameters (newParams);
+        standard.setParameters (newParams);
+        dense.setParameters (newParams);
+
+        wanted = toQuality (newParams.quality);
+
+        if (fadeProgress < fadeLength && wanted == previous) {
+            std::swap (previous, current);
+            currentAtBack = ! currentAtBack;
+            fadeProgress  = fadeLength - fadeProgress;
+        }
+    }
+
+    /** Returns the tier last asked for, which the reverb runs, or is fading or about to
+        fade to.
+    */
+    ReverbQuality getQuality() const noexcept { return wanted; }
+
+    //==============================================================================
+    /** Reserves the delay memory the tiers share and prepares each, see
+        ReverbEngine::prepare().
+    */
+    void prepare (const double maxSampleRate, const int maxBlockSize) {
+        tierSamples[(int) ReverbQuality::eco]      = eco.getDelaySamples (maxSampleRate);
+        tierSamples[(int) ReverbQuality::standard] = standard.getDelaySamples (maxSampleRate);
+        tierSamples[(int) ReverbQuality::dense]    = dense.getDelaySamples (maxSampleRate);
+
+        size_t total = 0, smallest = tierSamples[0];
+        for (const auto samples : tierSamples) {
+            total += samples;
+            smallest = juce::jmin (smallest, samples);
+        }
+
+        memorySize = total - smallest;
+        memory     = sharedMemory.allocate (memorySize);
+
+        // The running tier at the front; the idle ones never run before a switch places them.
+        currentAtBack = false;
+        for (const auto tier : { ReverbQuality::eco, ReverbQuality::standard, ReverbQuality::dense })
+            placeTier (tier, tier != current);
+
+        eco.prepare (maxSampleRate, maxBlockSize);
+        standard.prepare (maxSampleRate, maxBlockSize);
+        dense.prepare (maxSampleRate, maxBlockSize);
+        setRate (maxSampleRate);
+    }
+
+    /** Sets the sample rate of every tier, see ReverbEngine::setSampleRate(). */
+    void setSampleRate (const double newSampleRate) {
+        eco.setSampleRate (newSampleRate);
+        standard.setSampleRate (newSampleRate);
+        dense.setSampleRate (newSampleRate);
+        setRate (newSampleRate);
+    }
+
+    /** Sets every tier's reduced tank rate, see ReverbEngine::setMinTankRate(). */
+    void setMinTankRate (const double newMinTankRate) noexcept {
+        eco.setMinTankRate (newMinTankRate);
+        standard.setMinTankRate (newMinTankRate);
+        dense.setMinTankRate (newMinTankRate);
+    }
+
+    /** Lends every tier the pool, see ReverbEngine::setTaskPool(). */
+    void setTaskPool (TaskPool* const pool, const int minSamples) noexcept {
+        eco.setTaskPool (pool, minSamples);
+        standard.setTaskPool (pool, minSamples);
+        dense.setTaskPool (pool, minSamples);
+    }
+
+    /** Returns the latency of the tiers, which all have the same. */
+    int getLatencySamples() const noexcept { return standard.getLatencySamples(); }
+
+    /** Like ReverbEngine::getTailSamples(), for the tier running. */
+    int getTailSamples() const noexcept {
+        int tail = 0;
+        withTier (current, [&tail] (const auto& engine) { tail = engine.getTailSamples(); });
+        return tail;
+    }
+
+    /** Like ReverbEngine::isTailSilent(), for the tier running. Never true during a fade, or
+        with one to start.
+    */
+    bool isTailSilent() const noexcept {
+        bool silent = fadeProgress >= fadeLength && wanted == current;
+        withTier (current, [&silent] (const auto& engine) { silent = silent && engine.isTailSilent(); });
+        return silent;
+    }
+
+    /** Like ReverbEngine::skipSilence(), for the tier running. */
+    void skipSilence (const int numSamples) noexcept {
+        withTier (current, [numSamples] (auto& engine) { engine.skipSilence (numSamples); });
+    }
+
+    /** Returns the number of bytes this reverb occupies, delay lines included. Once prepared
+        the lines take the standard and dense tiers' worth, which any two tiers fit in for a
+        crossfade: in float at 48 kHz 318 KiB, where a set for every tier would take 372 KiB.
+        Outside a crossfade only the running tier's part of it is touched.
+    */
+    size_t getMemoryUsage() const noexcept {
+        return sizeof (*this) + sharedMemory.getNumBytes() + eco.getMemoryUsage() + standard.getMemoryUsage()
+               + dense.getMemoryUsage() - sizeof (eco) - sizeof (standard) - sizeof (dense);
+    }
+
+    /** Clears the reverb's buffers and finishes any crossfade, in constant time. */
+    void reset() {
+        if (wanted != current)
+            switchTo (wanted);
+
+        eco.reset();
+        standard.reset();
+        dense.reset();
+        fadeProgress = fadeLength;
+    }
+
+    //==============================================================================
+    /** Like ReverbEngine::processStereo(). */
+    template <typename IOType>
+    void processStereo (IOType* const left, IOType* const right, IOType* const out1, IOType* const out2, const int numSamples) noexcept {
+        IOType* const outputs[] = { out1, out2 };
+        process (outputs, numSamples, [left, right] (auto& engine, IOType* const* const out, const int start, const int num) {
+            engine.processStereo (left + start, right + start, out[0], out[1], num);
+        });
+    }
+
+    /** Like ReverbEngine::processBus(). */
+    template <typename IOType>
+    void processBus (const IOType* const* const left, const IOType* const* const right, const bool* const hasDry,
+                     const int numInputs, IOType* const out1, IOType* const out2, const int numSamples) noexcept {
+        IOType* const outputs[] = { out1, out2 };
+        process (outputs, numSamples, [=] (auto& engine, IOType* const* const out, const int start, const int num) {
+            const IOType* l[maxBusInputs];
+            const IOType* r[maxBusInputs];
+            const int n = juce::jmin (numInputs, (int) maxBusInputs);
+
+            for (int k = 0; k < n; ++k) {
+                l[k] = left[k] + start;
+                r[k] = right[k] + start;
+            }
+
+            engine.processBus (l, r, hasDry, n, out[0], out[1], num);
+        });
+    }
+
+    /** Like ReverbEngine::processMono(). */
+    template <typename IOType>
+    void processMono (const IOType* const in, IOType* const out, const int numSamples) noexcept {
+        IOType* const outputs[] = { out };
+        process (outputs, numSamples, [in] (auto& engine, IOType* const* const o, const int start, const int num) {
+            engine.processMono (in + start, o[0], num);
+        });
+    }
+
+private:
+    //==============================================================================
+    enum { fadeBlockSize = 256, maxBusInputs = 64 };
+
+    static ReverbQuality toQuality (const float quality) noexcept {
+        return (ReverbQuality) juce::jlimit (0, 2, juce::roundToInt (quality));
+    }
+
+    template <typename Function>
+    void withTier (const ReverbQuality tier, Function&& function) {
+        switch (tier) {
+            case ReverbQuality::eco:
+                function (eco);
+                break;
+            case ReverbQuality::standard:
+                function (standard);
+                break;
+            case ReverbQuality::dense:
+                function (dense);
+                break;
+        }
+    }
+
+    template <typename Function>
+    void withTier (const ReverbQuality tier, Function&& function) const {
+        const_cast<TieredReverb*> (this)->withTier (tier, [&function] (const auto& engine) { function (engine); });
+    }
+
+    /** Points a tier at the front or back end of the shared delay memory, once prepared. */
+    void placeTier (const ReverbQuality tier, const bool atBack) noexcept {
+        if (memory == nullptr)
+            return;
+
+        const size_t offset = atBack ? memorySize - tierSamples[(int) tier] : 0;
+        withTier (tier, [this, offset] (auto& engine) { engine.setDelayMemory (memory + offset); });
+    }
+
+    /** Makes tier the current one, fading in from the previous. It takes the end of the
+        delay memory the tier fading out doesn't hold, and as it has been idle, starts
+        silent with its smoothing at the targets.
+    */
+    void switchTo (const ReverbQuality tier) noexcept {
+        previous     = current;
+        current      = tier;
+        fadeProgress = 0;
+
+        currentAtBack = ! currentAtBack;
+        placeTier (current, currentAtBack);
+        withTier (current, [this] (auto& engine) {
+            engine.setSampleRate (sampleRate);
+            engine.reset();
+        });
+    }
+
+    void setRate (const double newSampleRate) noexcept {
+        sampleRate   = newSampleRate;
+        fadeLength   = juce::jmax (1, juce::roundToInt (crossfadeSeconds * newSampleRate));
+        fadeProgress = fadeLength;
+    }
+
+    /** Runs processBlock, which processes frames start to start + num into the given
+        outputs, on the current tier; and during a fade also on the previous one, blending
+        the two. The previous tier runs first, into scratch, so the current one may still
+        process in place. A fade to the tier wanted starts once any other has finished.
+    */
+    template <typename IOType, typename ProcessBlock>
+    void process (IOType* const* const outputs, const int numSamples, ProcessBlock&& processBlock) noexcept {
+        int start = 0;
+
+        while (start < numSamples) {
+            if (fadeProgress >= fadeLength) {
+                if (wanted == current)
+                    break;
+
+                switchTo (wanted);
+            }
+
+            const int num = juce::jmin ((int) fadeBlockSize, numSamples - start, fadeLength - fadeProgress);
+
+            alignas (64) IOType faded[numChannels][fadeBlockSize];
+            IOType* fadedOut[numChannels];
+            IOType* out[numChannels];
+
+            for (int c = 0; c < numChannels; ++c) {
+                fadedOut[c] = faded[c];
+                out[c]      = outputs[c] + start;
+            }
+
+            withTier (previous, [&] (auto& engine) { processBlock (engine, fadedOut, start, num); });
+            withTier (current, [&] (auto& engine) { processBlock (engine, out, start, num); });
+
+            const float step = 1.0f / (float) fadeLength;
+            for (int c = 0; c < numChannels; ++c) {
+                for (int i = 0; i < num; ++i) {
+                    const auto gain = (IOType) ((float) (fadeProgress + i + 1) * step);
+                    out[c][i]       = faded[c][i] + (out[c][i] - faded[c][i]) * gain;
+                }
+            }
+
+            fadeProgress += num;
+            start += num;
+        }
+
+        if (start < numSamples) {
+            IOType* out[numChannels];
+            for (int c = 0; c < numChannels; ++c)
+                out[c] = outputs[c] + start;
+
+            withTier (current, [&] (auto& engine) { processBlock (engine, out, start, numSamples - start); });
+        }
+    }
+
+    //==============================================================================
+    Eco eco;
+    Standard standard;
+    Dense dense;
+
+    DelayArena<StorageType> sharedMemory;
+    StorageType* memory = nullptr;
+    size_t memorySize = 0, tierSamples[3] {};
+    bool currentAtBack = false; // which end of memory the current tier holds
+
+    ReverbQuality current = ReverbQuality::standard, previous = ReverbQuality::standard, wanted = ReverbQuality::standard;
+    double sampleRate     = 44100.0;
+    int fadeLength = 1, fadeProgress = 1;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TieredReverb)
+};
+
+/** The tiered reverb the plugins run for one or two channels. */
+template <int numChannels>
+using PluginTieredReverb = TieredReverb<numChannels, PluginStorage>;
+
+} // namespace everb
@@ -0,0 +1,902 @@
+/*
+    This file is part of eVerb
+
+    Copyright (C) 2015-2025  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Compiled once per instruction set by src/meson.build, with EVERB_KERNEL_ISA set to
+// the variant name, which also names the namespace (e.g. everb::isa_avx2). Only the
+// kernels() tables have external linkage and nothing from JUCE is included, so no
+// code built for a wider ISA can leak into the rest of the plugin.
+//
+// The recurrences carry no denormal guards: callers run the kernels with flush-to-zero
+// and denormals-are-zero set, see ReverbEngine::processStereo().
+
+#include "kernels.hpp"
+
+#include <cstring>
+
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#    define EVERB_KERNEL_F16C 1
+#    include <immintrin.h>
+#else
+#    define EVERB_KERNEL_F16C 0
+#endif
+
+#ifndef EVERB_KERNEL_ISA
+#    error "EVERB_KERNEL_ISA must name the instruction set this file is built for"
+#endif
+
+#define EVERB_KERNEL_CONCAT_(a, b) a##b
+#define EVERB_KERNEL_CONCAT(a, b)  EVERB_KERNEL_CONCAT_ (a, b)
+#define EVERB_KERNEL_STRING_(a)    #a
+#define EVERB_KERNEL_STRING(a)     EVERB_KERNEL_STRING_ (a)
+
+namespace everb {
+namespace EVERB_KERNEL_CONCAT (isa_, EVERB_KERNEL_ISA) {
+namespace {
+
+// Converts between the delay line storage and the sample type the filters compute in.
+template <typename SampleType, typename StorageType>
+struct Storage {
+    static constexpr bool isNative = true;
+};
+
+// Half conversions, in integer arithmetic without branches so that every variant including
+// the SSE2 baseline converts whole vectors at once. Variants built for AVX2 and up use F16C
+// for the bulk instead, which every CPU with AVX2 has.
+template <>
+struct Storage<float, Half> {
+    static constexpr bool isNative = false;
+
+    static void load (const Half* const src, float* const dst, const int numSamples) noexcept {
+        int i = 0;
+#if EVERB_KERNEL_F16C
+        for (; i + 8 <= numSamples; i += 8)
+            _mm256_storeu_ps (dst + i, _mm256_cvtph_ps (_mm_loadu_si128 ((const __m128i*) (src + i))));
+#endif
+        for (; i < numSamples; ++i) {
+            const std::uint32_t h     = (std::uint32_t) src[i];
+            const std::uint32_t sign  = (h & 0x8000u) << 16;
+            const std::uint32_t mag   = h & 0x7fffu;
+            const std::uint32_t sub   = toBits ((float) (int) mag * 5.9604644775390625e-8f);
+            const std::uint32_t isSub = 0u - (std::uint32_t) (mag < 0x0400u);
+            dst[i]                    = fromBits (sign | (sub & isSub) | (((mag << 13) + 0x38000000u) & ~isSub));
+        }
+    }
+
+    // Rounds to nearest, ties to even, as F16C does: both paths store the same bits. Subnormals
+    // are truncated toward zero instead, so a decaying tail can't settle into a limit cycle a
+    // few steps above silence and always ends in zeros.
+    static void store (const float* const src, Half* const dst, const int numSamples) noexcept {
+        int i = 0;
+#if EVERB_KERNEL_F16C
+        for (; i + 8 <= numSamples; i += 8) {
+            const __m256 x         = _mm256_loadu_ps (src + i);
+            const __m128i nearest  = _mm256_cvtps_ph (x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+            const __m128i truncate = _mm256_cvtps_ph (x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+            const __m128i isSub    = _mm_cmpeq_epi16 (_mm_and_si128 (nearest, _mm_set1_epi16 (0x7c00)), _mm_setzero_si128());
+            _mm_storeu_si128 ((__m128i*) (dst + i), _mm_blendv_epi8 (nearest, truncate, isSub));
+        }
+#endif
+        for (; i < numSamples; ++i) {
+            const std::uint32_t bits   = toBits (src[i]);
+            const std::uint32_t sign   = (bits >> 16) & 0x8000u;
+            const std::uint32_t abs    = bits & 0x7fffffffu; // compares like the magnitude
+            const std::uint32_t isSub  = 0u - (std::uint32_t) (abs < 0x387fe000u); // rounds to below 2^-14
+            const std::uint32_t sub    = (std::uint32_t) (int) (fromBits (abs & isSub) * 16777216.0f);
+            const std::uint32_t normal = normalBits (abs < 0x38800000u ? 0x38800000u : (abs < 0x47800000u ? abs : 0x47800000u));
+            dst[i]                     = (Half) (sign | (sub & isSub) | (normal & ~isSub));
+        }
+    }
+
+    // The half bits of a float magnitude from 2^-14 up, rounded to nearest with ties to even.
+    // 2^16 and above give infinity.
+    static std::uint32_t normalBits (const std::uint32_t abs) noexcept {
+        return (abs + 0x0fffu + ((abs >> 13) & 1u) - 0x38000000u) >> 13;
+    }
+
+    static std::uint32_t toBits (const float x) noexcept {
+        std::uint32_t u;
+        std::memcpy (&u, &x, sizeof (u));
+        return u;
+    }
+
+    static float fromBits (const std::uint32_t u) noexcept {
+        float x;
+        std::memcpy (&x, &u, sizeof (x));
+        return x;
+    }
+};
+
+// Lines that aren't held in SampleType are converted into scratch space a chunk of this
+// many samples at a time, so that the filters themselves always run on SampleType.
+constexpr int conversionChunk = 128;
+
+// Returns the scale that makes a numLanes x numLanes Hadamard matrix orthonormal.
+constexpr double hadamardScale (int numLanes) noexcept {
+    double scale = 1.0;
+    for (; numLanes >= 4; numLanes /= 4)
+        scale *= 0.5;
+    return numLanes == 2 ? scale * 0.70710678118654752440 : scale;
+}
+
+// Multiplies x in place by the numLanes x numLanes Hadamard matrix, unscaled, in
+// log2 (numLanes) butterfly stages.
+template <int numLanes, typename SampleType>
+inline void hadamard (SampleType* const x) noexcept {
+    static_assert (numLanes > 0 && (numLanes & (numLanes - 1)) == 0, "Hadamard matrices here are a power of two");
+
+    for (int width = numLanes / 2; width > 0; width /= 2) {
+        for (int g = 0; g < numLanes; g += 2 * width) {
+            for (int j = 0; j < width; ++j) {
+                const SampleType a = x[g + j];
+                const SampleType b = x[g + j + width];
+                x[g + j]           = a + b;
+                x[g + j + width]   = a - b;
+            }
+        }
+    }
+}
+
+// Not std::min: that's an inline function every ISA variant instantiates, and the linker
+// may keep the one built for the widest ISA.
+constexpr int smaller (const int a, const int b) noexcept {
+    return a < b ? a : b;
+}
+
+// Returns where a line of size samples is read, delay samples behind its write head.
+inline int readIndex (const int index, const int delay, const int size) noexcept {
+    return index >= delay ? index - delay : index - delay + size;
+}
+
+// Steps lanes firstLane to firstLane + numToProcess - 1 of c, summing each group of
+// combsPerGroup into one output. With ramped false the coefficient arrays hold a single
+// value for the whole block.
+//
+// With mixed set each group forms a feedback delay network instead of separate combs: the
+// group's damped outputs go through an orthonormal Hadamard matrix before they're fed
+// back, so every lane's echoes reach every other lane of the group on the next pass.
+//
+// With moving set each lane is read at both its delay and its target, crossfading from one
+// to the other over the block.
+template <bool ramped, bool mixed, bool moving, int combsPerGroup, int firstLane, int numToProcess, typename SampleType, int numLanes, typename StorageType>
+void stepCombs (CombLanes<SampleType, numLanes, StorageType>& lanes,
+                const SampleType* const input,
+                const SampleType* const damp,
+                const SampleType* const feedbackLevel,
+                SampleType* const* const output,
+                const int numSamples) noexcept {
+    static_assert (firstLane + numToProcess <= numLanes && numToProcess % combsPerGroup == 0, "bad lane count");
+    using Line = Storage<SampleType, StorageType>;
+
+    // The filter state lives in locals for the whole block, so it can stay in registers
+    // instead of being reloaded after every store to a delay line.
+    alignas (64) SampleType last[numToProcess];
+    for (int j = 0; j < numToProcess; ++j)
+        last[j] = lanes.last[firstLane + j];
+
+    // The network's matrix scale is folded into the feedback.
+    constexpr SampleType mixScale   = SampleType (mixed ? hadamardScale (combsPerGroup) : 1.0);
+    const SampleType steadyDamp     = damp[0];
+    const SampleType steadyFeedback = feedbackLevel[0] * mixScale;
+    const SampleType fadeStep       = SampleType (1) / SampleType (numSamples);
+
+    constexpr int scratchLines = Line::isNative ? 1 : numToProcess;
+    constexpr int scratchSize  = Line::isNative ? 1 : conversionChunk;
+    constexpr int movingLines  = Line::isNative || ! moving ? 1 : numToProcess;
+    constexpr int movingSize   = Line::isNative || ! moving ? 1 : conversionChunk;
+    alignas (64) SampleType scratch[scratchLines][scratchSize], scratchRead[scratchLines][scratchSize];
+    alignas (64) SampleType scratchNext[movingLines][movingSize];
+
+    for (int done = 0; done < numSamples;) {
+        int run = numSamples - done;
+        int from[numToProcess], to[numToProcess];
+
+        // Runs end wherever a write head or read tap wraps, and are never longer than a
+        // delay, so nothing a run reads is written by the same run.
+        for (int j = 0; j < numToProcess; ++j) {
+            const int lane  = firstLane + j;
+            const int size  = lanes.size[lane];
+            const int index = lanes.index[lane];
+            from[j]         = readIndex (index, lanes.delay[lane], size);
+            run             = smaller (run, smaller (size - index, smaller (size - from[j], lanes.delay[lane])));
+
+            if constexpr (moving) {
+                to[j] = readIndex (index, lanes.target[lane], size);
+                run   = smaller (run, smaller (size - to[j], lanes.target[lane]));
+            }
+        }
+
+        if constexpr (! Line::isNative)
+            run = run < conversionChunk ? run : conversionChunk;
+
+        // A line cleared since its write head last wrapped still holds old samples from
+        // the write head on: zero what this run is about to read there.
+        for (int j = 0; j < numToProcess; ++j) {
+            const int lane = firstLane + j;
+            if (lanes.stale[lane] != 0) {
+                if (from[j] >= lanes.index[lane])
+                    std::memset (lanes.buffer[lane] + from[j], 0, sizeof (StorageType) * (size_t) run);
+                if (moving && to[j] >= lanes.index[lane])
+                    std::memset (lanes.buffer[lane] + to[j], 0, sizeof (StorageType) * (size_t) run);
+            }
+        }
+
+        SampleType* lines[numToProcess];
+        const SampleType* taps[numToProcess];
+        const SampleType* nextTaps[numToProcess];
+        if constexpr (Line::isNative) {
+            for (int j = 0; j < numToProcess; ++j) {
+                lines[j]    = lanes.buffer[firstLane + j] + lanes.index[firstLane + j];
+                taps[j]     = lanes.buffer[firstLane + j] + from[j];
+                nextTaps[j] = lanes.buffer[firstLane + j] + (moving ? to[j] : from[j]);
+            }
+        } else {
+            for (int j = 0; j < numToProcess; ++j) {
+                Line::load (lanes.buffer[firstLane + j] + from[j], scratchRead[j], run);
+                lines[j]    = scratch[j];
+                taps[j]     = scratchRead[j];
+                nextTaps[j] = scratchRead[j];
+
+                if constexpr (moving) {
+                    Line::load (lanes.buffer[firstLane + j] + to[j], scratchNext[j], run);
+                    nextTaps[j] = scratchNext[j];
+                }
+            }
+        }
+
+        for (int i = 0; i < run; ++i) {
+            const int s         = done + i;
+            const SampleType d  = ramped ? damp[s] : steadyDamp;
+            const SampleType fb = ramped ? feedbackLevel[s] * mixScale : steadyFeedback;
+            alignas (64) SampleType out[numToProcess];
+
+            for (int j = 0; j < numToProcess; ++j)
+                out[j] = taps[j][i];
+
+            if constexpr (moving) {
+                const SampleType fade = SampleType (s + 1) * fadeStep;
+                for (int j = 0; j < numToProcess; ++j)
+                    out[j] += (nextTaps[j][i] - out[j]) * fade;
+            }
+
+            for (int j = 0; j < numToProcess; ++j)
+                last[j] = (out[j] * (SampleType (1) - d)) + (last[j] * d);
+
+            if constexpr (mixed) {
+                alignas (64) SampleType feedback[numToProcess];
+                for (int j = 0; j < numToProcess; ++j)
+                    feedback[j] = last[j];
+
+                for (int g = 0; g < numToProcess; g += combsPerGroup)
+                    hadamard<combsPerGroup> (feedback + g);
+
+                for (int j = 0; j < numToProcess; ++j)
+                    lines[j][i] = input[s] + (feedback[j] * fb);
+            } else {
+                for (int j = 0; j < numToProcess; ++j)
+                    lines[j][i] = input[s] + (last[j] * fb);
+            }
+
+            for (int g = 0; g < numToProcess; g += combsPerGroup) {
+                for (int width = combsPerGroup / 2; width > 0; width /= 2)
+                    for (int j = 0; j < width; ++j)
+                        out[g + j] += out[g + j + width];
+                output[g / combsPerGroup][s] = out[g];
+            }
+        }
+
+        if constexpr (! Line::isNative) {
+            for (int j = 0; j < numToProcess; ++j)
+                Line::store (scratch[j], lanes.buffer[firstLane + j] + lanes.index[firstLane + j], run);
+        }
+
+        for (int j = 0; j < numToProcess; ++j) {
+            lanes.index[firstLane + j] += run;
+            if (lanes.index[firstLane + j] == lanes.size[firstLane + j]) {
+                lanes.index[firstLane + j] = 0;
+                lanes.stale[firstLane + j] = 0;
+            }
+        }
+
+        done += run;
+    }
+
+    for (int j = 0; j < numToProcess; ++j)
+        lanes.last[firstLane + j] = last[j];
+}
+
+// Steps the lanes with stepCombs, reading both taps only in blocks where a lane's read tap
+// moves, and leaves every lane read at its target.
+template <bool ramped, bool mixed, int combsPerGroup, int firstLane, int numToProcess, typename SampleType, int numLanes, typename StorageType>
+void processCombs (CombLanes<SampleType, numLanes, StorageType>& lanes,
+                   const SampleType* const input,
+                   const SampleType* const damp,
+                   const SampleType* const feedbackLevel,
+                   SampleType* const* const output,
+                   const int numSamples) noexcept {
+    bool moving = false;
+    for (int j = firstLane; j < firstLane + numToProcess; ++j)
+        moving |= lanes.delay[j] != lanes.target[j];
+
+    if (! moving) {
+        stepCombs<ramped, mixed, false, combsPerGroup, firstLane, numToProcess> (lanes, input, damp, feedbackLevel, output, numSamples);
+        return;
+    }
+
+    stepCombs<ramped, mixed, true, combsPerGroup, firstLane, numToProcess> (lanes, input, damp, feedbackLevel, output, numSamples);
+
+    for (int j = firstLane; j < firstLane + numToProcess; ++j)
+        lanes.delay[j] = lanes.target[j];
+}
+
+// Channels are stepped in groups of up to 16 lanes: stepping more lanes at once only makes
+// the runs between wraps shorter, without making the steps any wider.
+constexpr int maxLanesPerStep = 16;
+
+// Steps channels firstChannel to endChannel - 1.
+template <bool ramped, bool mixed, int numCombs, int numChannels, int firstChannel, int endChannel, typename SampleType, typename StorageType>
+void channelCombs (CombLanes<SampleType, numCombs * numChannels, StorageType>& lanes,
+                   const SampleType* input,
+                   const SampleType* damp,
+                   const SampleType* feedback,
+                   SampleType* const* output,
+                   int numSamples) noexcept {
+    if constexpr (firstChannel < endChannel) {
+        constexpr int perStep = numCombs < maxLanesPerStep ? maxLanesPerStep / numCombs : 1;
+        constexpr int numHere = endChannel - firstChannel < perStep ? endChannel - firstChannel : perStep;
+        processCombs<ramped, mixed, numCombs, firstChannel * numCombs, numHere * numCombs> (lanes, input, damp, feedback, output + firstChannel, numSamples);
+
+        channelCombs<ramped, mixed, numCombs, numChannels, firstChannel + numHere, endChannel> (lanes, input, damp, feedback, output, numSamples);
+    }
+}
+
+template <bool ramped, bool mixed, int numCombs, int numChannels, typename SampleType, typename StorageType>
+void combs (CombLanes<SampleType, numCombs * numChannels, StorageType>& lanes,
+            const SampleType* input,
+            const SampleType* damp,
+            const SampleType* feedback,
+            SampleType* const* output,
+            int numSamples) noexcept {
+    channelCombs<ramped, mixed, numCombs, numChannels, 0, numChannels> (lanes, input, damp, feedback, output, numSamples);
+}
+
+template <bool ramped, bool mixed, int half, int numCombs, int numChannels, typename SampleType, typename StorageType>
+void halfCombs (CombLanes<SampleType, numCombs * numChannels, StorageType>& lanes,
+                const SampleType* input,
+                const SampleType* damp,
+                const SampleType* feedback,
+                SampleType* const* output,
+                int numSamples) noexcept {
+    constexpr int middle = numChannels / 2;
+    channelCombs<ramped, mixed, numCombs, numChannels, half == 0 ? 0 : middle, half == 0 ? middle : numChannels> (lanes, input, damp, feedback, output, numSamples);
+}
+
+template <bool ramped, bool mixed, int numCombs, int numChannels, typename SampleType, typename StorageType>
+void firstCombs (CombLanes<SampleType, numCombs * numChannels, StorageType>& lanes,
+                 const SampleType* input,
+                 const SampleType* damp,
+                 const SampleType* feedback,
+                 SampleType* output,
+                 int numSamples) noexcept {
+    SampleType* const outputs[] = { output };
+    processCombs<ramped, mixed, numCombs, 0, numCombs> (lanes, input, damp, feedback, outputs, numSamples);
+}
+
+template <bool moving, typename SampleType, typename StorageType>
+void stepAllPasses (AllPassLine<StorageType>* const lines, const int numLines,
+                    SampleType* const samples, const int numSamples) noexcept {
+    using Line = Storage<SampleType, StorageType>;
+
+    const SampleType fadeStep = SampleType (1) / SampleType (numSamples);
+
+    // Chunks end wherever any stage wraps, so none is longer than the shortest delay.
+    // Within a chunk each stage only reads what it wrote at least a delay earlier, so
+    // the whole chain runs one stage at a time over a chunk still hot in L1.
+    for (int done = 0; done < numSamples;) {
+        int run = numSamples - done;
+        for (int k = 0; k < numLines; ++k) {
+            const AllPassLine<StorageType>& a = lines[k];
+            run = smaller (run, smaller (a.size - a.index, smaller (a.size - readIndex (a.index, a.delay, a.size), a.delay)));
+
+            if constexpr (moving)
+                run = smaller (run, smaller (a.size - readIndex (a.index, a.target, a.size), a.target));
+        }
+
+        if constexpr (! Line::isNative)
+            run = run < conversionChunk ? run : conversionChunk;
+
+        SampleType* const io = samples + done;
+
+        for (int k = 0; k < numLines; ++k) {
+            AllPassLine<StorageType>& a = lines[k];
+            const int from              = readIndex (a.index, a.delay, a.size);
+            const int to                = moving ? readIndex (a.index, a.target, a.size) : from;
+
+            if (a.stale) {
+                if (from >= a.index)
+                    std::memset (a.buffer + from, 0, sizeof (StorageType) * (size_t) run);
+                if (moving && to >= a.index)
+                    std::memset (a.buffer + to, 0, sizeof (StorageType) * (size_t) run);
+            }
+
+            SampleType* line;
+            const SampleType* tap;
+            const SampleType* nextTap;
+            alignas (64) SampleType scratch[Line::isNative ? 1 : conversionChunk], scratchRead[Line::isNative ? 1 : conversionChunk];
+            alignas (64) SampleType scratchNext[Line::isNative || ! moving ? 1 : conversionChunk];
+            if constexpr (Line::isNative) {
+                line    = a.buffer + a.index;
+                tap     = a.buffer + from;
+                nextTap = a.buffer + to;
+            } else {
+                Line::load (a.buffer + from, scratchRead, run);
+                line    = scratch;
+                tap     = scratchRead;
+                nextTap = scratchRead;
+
+                if constexpr (moving) {
+                    Line::load (a.buffer + to, scratchNext, run);
+                    nextTap = scratchNext;
+                }
+            }
+
+            for (int i = 0; i < run; ++i) {
+                const SampleType input   = io[i];
+                SampleType bufferedValue = tap[i];
+                if constexpr (moving)
+                    bufferedValue += (nextTap[i] - bufferedValue) * (SampleType (done + i + 1) * fadeStep);
+
+                line[i] = input + (bufferedValue * SampleType (0.5));
+                io[i]   = bufferedValue - input;
+            }
+
+            if constexpr (! Line::isNative)
+                Line::store (scratch, a.buffer + a.index, run);
+
+            a.index += run;
+            if (a.index == a.size) {
+                a.index = 0;
+                a.stale = false;
+            }
+        }
+
+        done += run;
+    }
+}
+
+// Like processCombs, reads both taps only in blocks where a stage's read tap moves.
+template <typename SampleType, typename StorageType>
+void allPasses (AllPassLine<StorageType>* const lines, const int numLines,
+                SampleType* const samples, const int numSamples) noexcept {
+    bool moving = false;
+    for (int k = 0; k < numLines; ++k)
+        moving |= lines[k].delay != lines[k].target;
+
+    if (! moving) {
+        stepAllPasses<false> (lines, numLines, samples, numSamples);
+        return;
+    }
+
+    stepAllPasses<true> (lines, numLines, samples, numSamples);
+
+    for (int k = 0; k < numLines; ++k)
+        lines[k].delay = lines[k].target;
+}
+
+// The resamplers apply one tap to every frame of the block before moving on to the next,
+// so each step is a vector multiply-add across frames rather than a dot product per sample.
+// They're built for each factor, so splitting samples into phases and back is a shuffle.
+template <int factor, typename SampleType>
+int decimateBy (const ResamplerTaps<SampleType>& taps, DecimatorState<SampleType>& state,
+                const SampleType* const input, const int numSamples, SampleType* const output) noexcept {
+    using Taps            = ResamplerTaps<SampleType>;
+    constexpr int history = Taps::tapsPerPhase - 1;
+    const int total       = state.numPending + numSamples;
+    const int numFrames   = total / factor;
+
+    // Only the first frame can start with pending samples.
+    int first = 0;
+    if (numFrames > 0 && state.numPending > 0) {
+        for (int p = 0; p < factor; ++p) {
+            const int s              = p - state.numPending;
+            state.phases[p][history] = s < 0 ? state.pending[p] : input[s];
+        }
+        first = 1;
+    }
+
+    const SampleType* const frames = input - state.numPending;
+    for (int f = first; f < numFrames; ++f)
+        for (int p = 0; p < factor; ++p)
+            state.phases[p][history + f] = frames[f * factor + p];
+
+    alignas (64) SampleType sum[Taps::maxFrames];
+    for (int f = 0; f < numFrames; ++f)
+        sum[f] = 0;
+
+    for (int p = 0; p < factor; ++p) {
+        for (int j = 0; j < Taps::tapsPerPhase; ++j) {
+            const SampleType tap      = taps.down[p][j];
+            const SampleType* const x = state.phases[p] + history - j;
+
+            for (int f = 0; f < numFrames; ++f)
+                sum[f] += tap * x[f];
+        }
+    }
+
+    for (int f = 0; f < numFrames; ++f)
+        output[f] = sum[f];
+
+    if (numFrames > 0)
+        for (int p = 0; p < factor; ++p)
+            std::memmove (state.phases[p], state.phases[p] + numFrames, sizeof (SampleType) * history);
+
+    const int left = total - numFrames * factor;
+    for (int i = 0; i < left; ++i) {
+        const int s      = numFrames * factor + i - state.numPending;
+        state.pending[i] = s < 0 ? state.pending[numFrames * factor + i] : input[s];
+    }
+
+    state.numPending = left;
+    return numFrames;
+}
+
+template <int factor, typename SampleType>
+void interpolateBy (const ResamplerTaps<SampleType>& taps, InterpolatorState<SampleType>& state,
+                    const SampleType* const input, const int numFrames, SampleType* const output) noexcept {
+    using Taps            = ResamplerTaps<SampleType>;
+    constexpr int history = Taps::tapsPerPhase - 1;
+
+    std::memcpy (state.history + history, input, sizeof (SampleType) * (size_t) numFrames);
+
+    alignas (64) SampleType sum[factor][Taps::maxFrames];
+    for (int p = 0; p < factor; ++p) {
+        for (int f = 0; f < numFrames; ++f)
+            sum[p][f] = 0;
+
+        for (int j = 0; j < Taps::tapsPerPhase; ++j) {
+            const SampleType tap      = taps.up[p][j];
+            const SampleType* const x = state.history + history - j;
+
+            for (int f = 0; f < numFrames; ++f)
+                sum[p][f] += tap * x[f];
+        }
+    }
+
+    for (int f = 0; f < numFrames; ++f)
+        for (int p = 0; p < factor; ++p)
+            output[f * factor + p] = sum[p][f];
+
+    std::memmove (state.history, state.history + numFrames, sizeof (SampleType) * history);
+}
+
+template <typename SampleType>
+int decimate (const ResamplerTaps<SampleType>& taps, DecimatorState<SampleType>& state,
+              const SampleType* const input, const int numSamples, SampleType* const output) noexcept {
+    static_assert (ResamplerTaps<SampleType>::maxFactor == 4, "factors are 2 and 4");
+    return taps.factor == 2 ? decimateBy<2> (taps, state, input, numSamples, output)
+                            : decimateBy<4> (taps, state, input, numSamples, output);
+}
+
+template <typename SampleType>
+void interpolate (const ResamplerTaps<SampleType>& taps, InterpolatorState<SampleType>& state,
+                  const SampleType* const input, const int numFrames, SampleType* const output) noexcept {
+    if (taps.factor == 2)
+        interpolateBy<2> (taps, state, input, numFrames, output);
+    else
+        interpolateBy<4> (taps, state, input, numFrames, output);
+}
+
+template <bool ramped, typename SampleType, typename IOType>
+void mixStereo (const SampleType* wetL, const SampleType* wetR,
+                const IOType* dryL, const IOType* dryR,
+                const SampleType* wet1, const SampleType* wet2, const SampleType* dry,
+                IOType* outL, IOType* outR,
+                int numSamples) noexcept {
+    const SampleType steadyWet1 = wet1[0], steadyWet2 = wet2[0], steadyDry = dry[0];
+
+    for (int i = 0; i < numSamples; ++i) {
+        const SampleType w1 = ramped ? wet1[i] : steadyWet1;
+        const SampleType w2 = ramped ? wet2[i] : steadyWet2;
+        const IOType d      = IOType (ramped ? dry[i] : steadyDry);
+        const IOType l      = IOType (wetL[i] * w1 + wetR[i] * w2) + dryL[i] * d;
+        const IOType r      = IOType (wetR[i] * w1 + wetL[i] * w2) + dryR[i] * d;
+        outL[i]             = l;
+        outR[i]             = r;
+    }
+}
+
+template <bool ramped, typename SampleType, typename IOType>
+void mixMono (const SampleType* wet, const IOType* dryIn,
+              const SampleType* wet1, const SampleType* dry,
+              IOType* out,
+              int numSamples) noexcept {
+    const SampleType steadyWet1 = wet1[0], steadyDry = dry[0];
+
+    for (int i = 0; i < numSamples; ++i) {
+        const SampleType w1 = ramped ? wet1[i] : steadyWet1;
+        const IOType d      = IOType (ramped ? dry[i] : steadyDry);
+        out[i]              = IOType (wet[i] * w1) + dryIn[i] * d;
+    }
+}
+
+template <bool ramped, int numChannels, typename SampleType, typename IOType>
+void mixChannels (SampleType* const* wet, const IOType* const* dryIn,
+                  const SampleType* wet1, const SampleType* wet2, const SampleType* dry,
+                  IOType* const* out,
+                  int numSamples) noexcept {
+    const SampleType steadyWet1 = wet1[0], steadyWet2 = wet2[0], steadyDry = dry[0];
+    const SampleType otherScale = numChannels > 1 ? SampleType (1) / SampleType (numChannels - 1) : SampleType (0);
+
+    // The other channels' mean is taken from the sum of all, so it costs the same for any
+    // number of channels.
+    constexpr int chunk = 64;
+    for (int start = 0; start < numSamples; start += chunk) {
+        const int num = numSamples - start < chunk ? numSamples - start : chunk;
+        alignas (64) SampleType total[chunk];
+
+        for (int i = 0; i < num; ++i)
+            total[i] = wet[0][start + i];
+
+        for (int c = 1; c < numChannels; ++c)
+            for (int i = 0; i < num; ++i)
+                total[i] += wet[c][start + i];
+
+        for (int c = 0; c < numChannels; ++c) {
+            const SampleType* const w = wet[c] + start;
+            const IOType* const in    = dryIn[c] + start;
+            IOType* const o           = out[c] + start;
+
+            for (int i = 0; i < num; ++i) {
+                const int s          = start + i;
+                const SampleType w1  = ramped ? wet1[s] : steadyWet1;
+                const SampleType w2  = ramped ? wet2[s] : steadyWet2;
+                const IOType d       = IOType (ramped ? dry[s] : steadyDry);
+                const SampleType mix = w[i] * w1 + (total[i] - w[i]) * otherScale * w2;
+                o[i]                 = IOType (mix) + in[i] * d;
+            }
+        }
+    }
+}
+
+// The bank kernels step every lane of a line together: all lanes of a line have the same
+// length, so they share one write head. Each loop over the lanes becomes one vector
+// operation, as everything a step reads is loaded before any of it is stored.
+template <bool ramped, int numCombs, int numLanes, typename SampleType>
+void bankCombs (BankCombs<SampleType, numCombs, numLanes>& c,
+                const SampleType* const input,
+                const SampleType* const damp,
+                const SampleType* const feedbackLevel,
+                SampleType* const output,
+                const int numFrames) noexcept {
+    alignas (64) SampleType last[numCombs][numLanes];
+    for (int j = 0; j < numCombs; ++j)
+        for (int k = 0; k < numLanes; ++k)
+            last[j][k] = c.last[j][k];
+
+    alignas (64) SampleType steadyDamp[numLanes], steadyFeedback[numLanes];
+    for (int k = 0; k < numLanes; ++k) {
+        steadyDamp[k]     = damp[k];
+        steadyFeedback[k] = feedbackLevel[k];
+    }
+
+    for (int done = 0; done < numFrames;) {
+        int run = numFrames - done;
+        for (int j = 0; j < numCombs; ++j)
+            if (c.lines[j].size - c.lines[j].index < run)
+                run = c.lines[j].size - c.lines[j].index;
+
+        SampleType* frames[numCombs];
+        for (int j = 0; j < numCombs; ++j) {
+            frames[j] = c.lines[j].buffer + (size_t) c.lines[j].index * numLanes;
+            if (c.lines[j].stale)
+                std::memset (frames[j], 0, sizeof (SampleType) * numLanes * (size_t) run);
+        }
+
+        // Frame by frame with every comb in turn, so the combs' feedback recurrences
+        // overlap instead of each waiting on its own.
+        for (int i = 0; i < run; ++i) {
+            const int s = done + i;
+            alignas (64) SampleType in[numLanes], d[numLanes], fb[numLanes], out[numCombs][numLanes];
+
+            for (int k = 0; k < numLanes; ++k) {
+                in[k] = input[s * numLanes + k];
+                d[k]  = ramped ? damp[s * numLanes + k] : steadyDamp[k];
+                fb[k] = ramped ? feedbackLevel[s * numLanes + k] : steadyFeedback[k];
+            }
+
+            for (int j = 0; j < numCombs; ++j) {
+                SampleType* const frame = frames[j] + i * numLanes;
+
+                for (int k = 0; k < numLanes; ++k)
+                    out[j][k] = frame[k];
+
+                for (int k = 0; k < numLanes; ++k)
+                    last[j][k] = (out[j][k] * (SampleType (1) - d[k])) + (last[j][k] * d[k]);
+
+                for (int k = 0; k < numLanes; ++k)
+                    frame[k] = in[k] + (last[j][k] * fb[k]);
+            }
+
+            for (int j = 1; j < numCombs; ++j)
+                for (int k = 0; k < numLanes; ++k)
+                    out[0][k] += out[j][k];
+
+            for (int k = 0; k < numLanes; ++k)
+                output[s * numLanes + k] = out[0][k];
+        }
+
+        for (int j = 0; j < numCombs; ++j) {
+            LaneLine<SampleType, numLanes>& line = c.lines[j];
+            line.index += run;
+            if (line.index == line.size) {
+                line.index = 0;
+                line.stale = false;
+            }
+        }
+
+        done += run;
+    }
+
+    for (int j = 0; j < numCombs; ++j)
+        for (int k = 0; k < numLanes; ++k)
+            c.last[j][k] = last[j][k];
+}
+
+template <int numLanes, typename SampleType>
+void bankAllPasses (LaneLine<SampleType, numLanes>* const lines, const int numLines,
+                    SampleType* const io, const int numFrames) noexcept {
+    for (int j = 0; j < numLines; ++j) {
+        LaneLine<SampleType, numLanes>& line = lines[j];
+
+        for (int done = 0; done < numFrames;) {
+            const int left = line.size - line.index;
+            const int run  = numFrames - done < left ? numFrames - done : left;
+
+            SampleType* const frames = line.buffer + (size_t) line.index * numLanes;
+            if (line.stale)
+                std::memset (frames, 0, sizeof (SampleType) * numLanes * (size_t) run);
+
+            SampleType* const samples = io + (size_t) done * numLanes;
+            for (int i = 0; i < run * numLanes; ++i) {
+                const SampleType input         = samples[i];
+                const SampleType bufferedValue = frames[i];
+                frames[i]                      = input + (bufferedValue * SampleType (0.5));
+                samples[i]                     = bufferedValue - input;
+            }
+
+            line.index += run;
+            if (line.index == line.size) {
+                line.index = 0;
+                line.stale = false;
+            }
+
+            done += run;
+        }
+    }
+}
+
+template <int numLanes, typename SampleType, typename IOType>
+void bankInput (const IOType* const* const left, const IOType* const* const right,
+                const SampleType* const gain,
+                SampleType* const frames,
+                const int numFrames) noexcept {
+    alignas (64) SampleType laneGain[numLanes];
+    for (int k = 0; k < numLanes; ++k)
+        laneGain[k] = gain[k];
+
+    for (int i = 0; i < numFrames; ++i) {
+        alignas (64) SampleType in[numLanes];
+
+        for (int k = 0; k < numLanes; ++k)
+            in[k] = SampleType (left[k][i] + right[k][i]);
+
+        for (int k = 0; k < numLanes; ++k)
+            frames[i * numLanes + k] = in[k] * laneGain[k];
+    }
+}
+
+template <bool ramped, int numLanes, typename SampleType, typename IOType>
+void bankMixStereo (const SampleType* const wetL, const SampleType* const wetR,
+                    const IOType* const* const dryL, const IOType* const* const dryR,
+                    const SampleType* const wet1, const SampleType* const wet2, const SampleType* const dry,
+                    IOType* const* const outL, IOType* const* const outR,
+                    const int numFrames) noexcept {
+    for (int i = 0; i < numFrames; ++i) {
+        const int frame = i * numLanes;
+        const int ramp  = ramped ? frame : 0;
+        alignas (64) IOType l[numLanes], r[numLanes];
+
+        for (int k = 0; k < numLanes; ++k) {
+            const SampleType w1 = wet1[ramp + k];
+            const SampleType w2 = wet2[ramp + k];
+            const IOType d      = IOType (dry[ramp + k]);
+            l[k]                = IOType (wetL[frame + k] * w1 + wetR[frame + k] * w2) + dryL[k][i] * d;
+            r[k]                = IOType (wetR[frame + k] * w1 + wetL[frame + k] * w2) + dryR[k][i] * d;
+        }
+
+        for (int k = 0; k < numLanes; ++k) {
+            outL[k][i] = l[k];
+            outR[k][i] = r[k];
+        }
+    }
+}
+
+} // namespace
+
+template <int numCombs, int numChannels, typename SampleType, typename StorageType>
+const Kernels<numCombs, numChannels, SampleType, StorageType>& kernels() noexcept {
+    static const Kernels<numCombs, numChannels, SampleType, StorageType> table = {
+        EVERB_KERNEL_STRING (EVERB_KERNEL_ISA),
+        &combs<true, false, numCombs, numChannels, SampleType, StorageType>,
+        &firstCombs<true, false, numCombs, numChannels, SampleType, StorageType>,
+        &combs<false, false, numCombs, numChannels, SampleType, StorageType>,
+        &firstCombs<false, false, numCombs, numChannels, SampleType, StorageType>,
+        &combs<true, true, numCombs, numChannels, SampleType, StorageType>,
+        &firstCombs<true, true, numCombs, numChannels, SampleType, StorageType>,
+        &combs<false, true, numCombs, numChannels, SampleType, StorageType>,
+        &firstCombs<false, true, numCombs, numChannels, SampleType, StorageType>,
+        { &halfCombs<true, false, 0, numCombs, numChannels, SampleType, StorageType>,
+          &halfCombs<true, false, 1, numCombs, numChannels, SampleType, StorageType> },
+        { &halfCombs<false, false, 0, numCombs, numChannels, SampleType, StorageType>,
+          &halfCombs<false, false, 1, numCombs, numChannels, SampleType, StorageType> },
+        { &halfCombs<true, true, 0, numCombs, numChannels, SampleType, StorageType>,
+          &halfCombs<true, true, 1, numCombs, numChannels, SampleType, StorageType> },
+        { &halfCombs<false, true, 0, numCombs, numChannels, SampleType, StorageType>,
+          &halfCombs<false, true, 1, numCombs, numChannels, SampleType, StorageType> },
+        &allPasses<SampleType, StorageType>,
+        &decimate<SampleType>,
+        &interpolate<SampleType>,
+        { &mixStereo<true, SampleType, float>, &mixMono<true, SampleType, float>,
+          &mixChannels<true, numChannels, SampleType, float>,
+          &mixStereo<false, SampleType, float>, &mixMono<false, SampleType, float>,
+          &mixChannels<false, numChannels, SampleType, float> },
+        { &mixStereo<true, SampleType, double>, &mixMono<true, SampleType, double>,
+          &mixChannels<true, numChannels, SampleType, double>,
+          &mixStereo<false, SampleType, double>, &mixMono<false, SampleType, double>,
+          &mixChannels<false, numChannels, SampleType, double> }
+    };
+    return table;
+}
+
+#define EVERB_INSTANTIATE_KERNELS(c, n, s, d) \
+    template const Kernels<c, n, s, d>& kernels<c, n, s, d>() noexcept;
+EVERB_KERNEL_TOPOLOGIES (EVERB_INSTANTIATE_KERNELS)
+#undef EVERB_INSTANTIATE_KERNELS
+
+template <int numCombs, int numLanes, typename SampleType>
+const BankKernels<numCombs, numLanes, SampleType>& bankKernels() noexcept {
+    static const BankKernels<numCombs, numLanes, SampleType> table = {
+        EVERB_KERNEL_STRING (EVERB_KERNEL_ISA),
+        &bankCombs<true, numCombs, numLanes, SampleType>,
+        &bankCombs<false, numCombs, numLanes, SampleType>,
+        &bankAllPasses<numLanes, SampleType>,
+        { &bankInput<numLanes, SampleType, float>,
+          &bankMixStereo<true, numLanes, SampleType, float>, &bankMixStereo<false, numLanes, SampleType, float> },
+        { &bankInput<numLanes, SampleType, double>,
+          &bankMixStereo<true, numLanes, SampleType, double>, &bankMixStereo<false, numLanes, SampleType, double> }
+    };
+    return table;
+}
+
+#define EVERB_INSTANTIATE_BANK_KERNELS(c, n, s) \
+    template const BankKernels<c, n, s>& bankKernels<c, n, s>() noexcept;
+EVERB_BANK_TOPOLOGIES (EVERB_INSTANTIATE_BANK_KERNELS)
+#undef EVERB_INSTANTIATE_BANK_KERNELS
+
+} // namespace isa_*
+} // namespace everb
@@ -0,0 +1,337 @@
+/*
+    This file is part of eVerb
+
+    Copyright (C) 2015-2025  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// This header is included by kernels.cpp, which is compiled once per instruction set.
+// Keep it to plain data and declarations: an inline function defined here could be
+// emitted with AVX-512 code and picked by the linker for every other translation unit.
+
+#include <cstdint>
+
+/** The engine topologies the kernels are built for, as (combs, channels, sample type,
+    storage type). A ReverbEngine with any other topology links only once it's listed here.
+*/
+#define EVERB_KERNEL_TOPOLOGIES(X) \
+    X (4, 1, float, float)         \
+    X (4, 1, float, Half)          \
+    X (4, 2, float, float)         \
+    X (4, 2, float, Half)          \
+    X (16, 1, float, float)        \
+    X (16, 1, float, Half)         \
+    X (16, 2, float, float)        \
+    X (16, 2, float, Half)         \
+    X (8, 1, float, float)         \
+    X (8, 1, float, Half)          \
+    X (8, 2, float, float)         \
+    X (8, 2, double, double)       \
+    X (8, 2, float, Half)          \
+    X (8, 4, float, float)         \
+    X (8, 4, float, Half)          \
+    X (8, 6, float, float)         \
+    X (8, 6, float, Half)          \
+    X (8, 8, float, float)         \
+    X (8, 8, float, Half)          \
+    X (8, 12, float, float)        \
+    X (8, 12, float, Half)
+
+/** The reverb bank topologies the kernels are built for, as (combs, lanes, sample type). */
+#define EVERB_BANK_TOPOLOGIES(X) \
+    X (8, 4, float)              \
+    X (8, 8, float)              \
+    X (8, 16, float)
+
+namespace everb {
+
+/** A delay line sample held as IEEE 754 half precision bits. */
+enum class Half : std::uint16_t {};
+
+//==============================================================================
+/** Delay line state of a comb bank, one lane per comb. The lines hold StorageType,
+    the filter state is kept in SampleType.
+*/
+template <typename SampleType, int numLanes, typename StorageType = SampleType>
+struct CombLanes {
+    StorageType* buffer[numLanes] {};
+    alignas (64) SampleType last[numLanes] {};
+    alignas (64) int size[numLanes] {};  /**< Samples in the buffer, where the write head wraps. */
+    alignas (64) int index[numLanes] {}; /**< The write head. */
+
+    /** How far behind the write head each line is read, 1 to size. A kernel that finds
+        target differing moves the read tap there over its block, crossfading from the old
+        tap to the new one, and then sets delay to target.
+    */
+    alignas (64) int delay[numLanes] {};
+    alignas (64) int target[numLanes] {};
+
+    /** Nonzero while a line still holds samples from before it was cleared, from index to
+        the end. The kernels zero that part as the write head reaches it.
+    */
+    alignas (64) int stale[numLanes] {};
+};
+
+/** Delay line state of a single all-pass filter. */
+template <typename StorageType>
+struct AllPassLine {
+    StorageType* buffer = nullptr;
+    int size = 0, index = 0;
+    int delay = 0, target = 0; /**< Same as CombLanes::delay and CombLanes::target. */
+    bool stale = false; /**< Same as CombLanes::stale. */
+};
+
+/** A delay line shared by numLanes filters of the same length, one per reverb of a bank.
+
+    The lanes are interleaved, frame i of lane k being buffer[i * numLanes + k], so one
+    step of every lane is a single contiguous vector. size and index count frames.
+*/
+template <typename SampleType, int numLanes>
+struct LaneLine {
+    SampleType* buffer = nullptr;
+    int size = 0, index = 0;
+    bool stale = false; /**< Same as CombLanes::stale. */
+};
+
+/** The comb filters of one channel of a reverb bank. */
+template <typename SampleType, int numCombs, int numLanes>
+struct BankCombs {
+    LaneLine<SampleType, numLanes> lines[numCombs];
+    alignas (64) SampleType last[numCombs][numLanes] {};
+};
+
+//==============================================================================
+/** The polyphase filters that take a tank down to 1/factor of the host rate and back,
+    see ReverbEngine::setMinTankRate(). Each has tapsPerPhase * factor taps, split into
+    factor phases of tapsPerPhase.
+*/
+template <typename SampleType>
+struct ResamplerTaps {
+    static constexpr int maxFactor = 4, tapsPerPhase = 16;
+
+    /** The most host samples one call to Kernels::decimate takes, and the most tank samples
+        it can give back for them.
+    */
+    static constexpr int maxInput = 256, maxFrames = maxInput / 2 + 1;
+
+    int factor = 1;
+
+    /** down[p][j] weighs input phase p of the frame j frames back. up[p][j] weighs the tank
+        sample j samples back for output phase p.
+    */
+    alignas (64) SampleType down[maxFactor][tapsPerPhase] {}, up[maxFactor][tapsPerPhase] {};
+};
+
+/** A decimator's input, split into frames of factor samples held one array per phase, each
+    with tapsPerPhase - 1 frames of history ahead of the new ones. Samples that don't fill a
+    frame yet wait in pending.
+*/
+template <typename SampleType>
+struct DecimatorState {
+    using Taps = ResamplerTaps<SampleType>;
+
+    alignas (64) SampleType phases[Taps::maxFactor][Taps::tapsPerPhase - 1 + Taps::maxFrames] {};
+    SampleType pending[Taps::maxFactor] {};
+    int numPending = 0;
+};
+
+/** An interpolator's input, with tapsPerPhase - 1 samples of history ahead of the new ones. */
+template <typename SampleType>
+struct InterpolatorState {
+    using Taps = ResamplerTaps<SampleType>;
+
+    alignas (64) SampleType history[Taps::tapsPerPhase - 1 + Taps::maxFrames] {};
+};
+
+//==============================================================================
+/** The hot processing loops of a reverb topology, compiled for one instruction set.
+
+    One table exists for every ISA variant the plugin was built with. Use best() to
+    get the fastest one this CPU can run.
+
+    With a StorageType of Half the delay lines hold half precision samples while all
+    arithmetic is still done in float. That halves the delay memory, at the cost of a
+    noise floor well below the reverb's output (see ReverbCompact).
+*/
+template <int numCombs, int numChannels, typename SampleType, typename StorageType = SampleType>
+struct Kernels {
+    static constexpr int numLanes = numCombs * numChannels;
+    using Combs                   = CombLanes<SampleType, numLanes, StorageType>;
+
+    /** Name of the instruction set, e.g. "avx2". */
+    const char* name;
+
+    /** Runs every comb lane over a block and writes the summed output of each channel. */
+    void (*combs) (Combs& combs,
+                   const SampleType* input,
+                   const SampleType* damp,
+                   const SampleType* feedback,
+                   SampleType* const* output,
+                   int numSamples) noexcept;
+
+    /** Runs the first channel's comb lanes over a block. */
+    void (*firstCombs) (Combs& combs,
+                        const SampleType* input,
+                        const SampleType* damp,
+                        const SampleType* feedback,
+                        SampleType* output,
+                        int numSamples) noexcept;
+
+    /** Same as combs and firstCombs, for when the coefficients aren't ramping: only
+        damp[0] and feedback[0] are read and used for the whole block.
+    */
+    decltype (combs) steadyCombs;
+    decltype (firstCombs) steadyFirstCombs;
+
+    /** Same as combs, firstCombs and their steady versions, with each channel's lanes
+        forming a feedback delay network instead of separate combs: every step mixes the
+        channel's damped outputs through an orthonormal Hadamard matrix before feeding
+        them back. numCombs must be a power of two.
+    */
+    decltype (combs) network;
+    decltype (firstCombs) firstNetwork;
+    decltype (combs) steadyNetwork;
+    decltype (firstCombs) steadyFirstNetwork;
+
+    /** Same as combs, steadyCombs, network and steadyNetwork, for half of the channels:
+        [0] runs channels 0 to numChannels / 2 - 1 and [1] the rest. The halves touch
+        different lanes and outputs, so they may run on two threads at once.
+    */
+    decltype (combs) halfCombs[2];
+    decltype (combs) steadyHalfCombs[2];
+    decltype (combs) halfNetwork[2];
+    decltype (combs) steadyHalfNetwork[2];
+
+    /** Filters a block in place through numLines all-pass delay lines in series. */
+    void (*allPasses) (AllPassLine<StorageType>* lines, int numLines, SampleType* samples, int numSamples) noexcept;
+
+    /** Low-pass filters numSamples of input, continuing from state, and keeps every
+        taps.factor-th sample, the last of each frame. Returns how many went to output.
+    */
+    int (*decimate) (const ResamplerTaps<SampleType>& taps, DecimatorState<SampleType>& state,
+                     const SampleType* input, int numSamples, SampleType* output) noexcept;
+
+    /** Raises numFrames samples of input by taps.factor, continuing from state, writing
+        numFrames * taps.factor samples of output.
+    */
+    void (*interpolate) (const ResamplerTaps<SampleType>& taps, InterpolatorState<SampleType>& state,
+                         const SampleType* input, int numFrames, SampleType* output) noexcept;
+
+    /** Output stage for host buffers of IOType. The dry signal is scaled in IOType, so a
+        64-bit host keeps its precision on the dry path whatever the delay lines hold.
+    */
+    template <typename IOType>
+    struct Mix {
+        /** Mixes the wet stereo pair with the dry input, per sample gains. */
+        void (*stereo) (const SampleType* wetL, const SampleType* wetR,
+                        const IOType* dryL, const IOType* dryR,
+                        const SampleType* wet1, const SampleType* wet2, const SampleType* dry,
+                        IOType* outL, IOType* outR,
+                        int numSamples) noexcept;
+
+        /** Mixes a wet mono signal with the dry input, per sample gains. */
+        void (*mono) (const SampleType* wet, const IOType* dryIn,
+                      const SampleType* wet1, const SampleType* dry,
+                      IOType* out,
+                      int numSamples) noexcept;
+
+        /** Mixes every channel's wet signal, crossfed with the mean of the other channels'
+            by wet2, with its dry input. Per sample gains.
+        */
+        void (*channels) (SampleType* const* wet, const IOType* const* dryIn,
+                          const SampleType* wet1, const SampleType* wet2, const SampleType* dry,
+                          IOType* const* out,
+                          int numSamples) noexcept;
+
+        /** Same as stereo, mono and channels, using only the first entry of each gain array. */
+        decltype (stereo) steadyStereo;
+        decltype (mono) steadyMono;
+        decltype (channels) steadyChannels;
+    };
+
+    Mix<float> mix32;
+    Mix<double> mix64;
+
+    /** Returns the kernels every supported CPU can run. */
+    static const Kernels& baseline() noexcept;
+
+    /** Returns the fastest kernels the running CPU supports. The check is done once. */
+    static const Kernels& best() noexcept;
+};
+
+//==============================================================================
+/** The hot loops of a reverb bank, which runs numLanes reverbs of one topology side by
+    side. All buffers hold interleaved frames like a LaneLine: numLanes samples per frame,
+    one for each reverb.
+*/
+template <int numCombs, int numLanes, typename SampleType>
+struct BankKernels {
+    using Combs = BankCombs<SampleType, numCombs, numLanes>;
+    using Line  = LaneLine<SampleType, numLanes>;
+
+    /** Name of the instruction set, e.g. "avx2". */
+    const char* name;
+
+    /** Runs one channel's combs over a block and writes their summed output. damp and
+        feedback hold a value per lane for every frame.
+    */
+    void (*combs) (Combs& combs,
+                   const SampleType* input,
+                   const SampleType* damp,
+                   const SampleType* feedback,
+                   SampleType* output,
+                   int numFrames) noexcept;
+
+    /** Same as combs, with damp and feedback holding a single frame for the whole block. */
+    decltype (combs) steadyCombs;
+
+    /** Filters a block in place through numLines all-pass delay lines in series. */
+    void (*allPasses) (Line* lines, int numLines, SampleType* frames, int numFrames) noexcept;
+
+    /** Input and output stages for host buffers of IOType, with one channel pointer per
+        lane. As with Kernels::Mix, the dry signal is scaled in IOType.
+    */
+    template <typename IOType>
+    struct Mix {
+        /** Interleaves the lanes' summed stereo inputs, each scaled by its lane's gain. */
+        void (*input) (const IOType* const* left, const IOType* const* right,
+                       const SampleType* gain,
+                       SampleType* frames,
+                       int numFrames) noexcept;
+
+        /** Mixes each lane's wet stereo pair with its dry input, per frame gains. */
+        void (*stereo) (const SampleType* wetL, const SampleType* wetR,
+                        const IOType* const* dryL, const IOType* const* dryR,
+                        const SampleType* wet1, const SampleType* wet2, const SampleType* dry,
+                        IOType* const* outL, IOType* const* outR,
+                        int numFrames) noexcept;
+
+        /** Same as stereo, with the gains holding a single frame for the whole block. */
+        decltype (stereo) steadyStereo;
+    };
+
+    Mix<float> mix32;
+    Mix<double> mix64;
+
+    /** Returns the kernels every supported CPU can run. */
+    static const BankKernels& baseline() noexcept;
+
+    /** Returns the fastest kernels the running CPU supports. The check is done once. */
+    static const BankKernels& best() noexcept;
+};
+
+} // namespace everb
@@ -23,40 +23,39 @@
 #include "everb.hpp"
 #include "ports.hpp"
 
-#define EVERB_URI "https://kushview.net/plugins/everb"
+#define EVERB_URI                "https://kushview.net/plugins/everb"
+#define EVERB_MONO_URI           EVERB_URI "/mono"
+#define EVERB_MONO_TO_STEREO_URI EVERB_URI "/mono-to-stereo"
 
 namespace everb {
 
-class Module final : public lvtk::Plugin<Module> {
+/** The LV2 plugin for a channel layout: stereo, mono, or mono in and stereo out. Mono runs
+    single channel engines, at about half the cost of stereo.
+*/
+template <uint32_t numInputs, uint32_t numOutputs>
+class Module final : public lvtk::Plugin<Module<numInputs, numOutputs>> {
 public:
+    using Layout = PortLayout<numInputs, numOutputs>;
+    using Engine = PluginTieredReverb<numOutputs>;
+
     Module (const lvtk::Args& args)
-        : Plugin (args),
+        : lvtk::Plugin<Module> (args),
           sampleRate (args.sample_rate),
           bundlePath (args.bundle) {}
 
     ~Module() {}
 
     void connect_port (uint32_t port, void* data) {
-        switch (port) {
-            case Ports::AudioIn_1:
-                input[0] = (float*) data;
-                break;
-            case Ports::AudioIn_2:
-                input[1] = (float*) data;
-                break;
-            case Ports::AudioOut_1:
-                output[0] = (float*) data;
-                break;
-            case Ports::AudioOut_2:
-                output[1] = (float*) data;
-                break;
-        }
+        if (port < numInputs)
+            input[port] = (float*) data;
+        else if (port < Layout::firstControl)
+            output[port - numInputs] = (float*) data;
 
         // Lilv will connect NULL on instantiate... just return
         if (data == nullptr)
             return;
 
-        switch (port) {
+        switch (Layout::toParam (port)) {
             case Ports::Wet:
                 params.wetLevel = *((float*) data);
                 break;
@@ -72,13 +71,23 @@ public:
             case Ports::Damping:
                 params.damping = *((float*) data);
                 break;
+            case Ports::Quality:
+                params.quality = *((float*) data);
+                break;
+            case Ports::Network:
+                params.network = *((float*) data);
+                break;
+            case Ports::Size:
+                params.size = *((float*) data);
+                break;
         }
     }
 
     void activate() {
+        verb.useBestKernels();
         verb.reset();
         verb.setParameters ({});
-        verb.setSampleRate (sampleRate);
+        verb.prepare (sampleRate, 0); // LV2 fixes the rate per instance, block size unknown
         params = verb.getParameters();
     }
 
@@ -87,24 +96,38 @@ public:
     }
 
     void run (uint32_t _nframes) noexcept {
+        const juce::ScopedNoDenormals noDenormals;
         const auto nframes = static_cast<int> (_nframes);
 
         const auto& vp = verb.getParameters();
-        if (vp.damping != params.damping || vp.dryLevel != params.dryLevel || vp.freezeMode != params.freezeMode || vp.roomSize != params.roomSize || vp.wetLevel != params.wetLevel || vp.width != params.width) {
+        if (vp.damping != params.damping || vp.dryLevel != params.dryLevel || vp.freezeMode != params.freezeMode || vp.roomSize != params.roomSize || vp.wetLevel != params.wetLevel || vp.width != params.width || vp.quality != params.quality || vp.network != params.network || vp.size != params.size) {
             verb.setParameters (params);
         }
 
-        verb.processStereo (input[0], input[1], output[0], output[1], nframes);
+        // A silent track with its tail died away gives silence: skip the tank.
+        if (verb.isTailSilent() && isSilence (input, (int) numInputs, nframes)) {
+            verb.skipSilence (nframes);
+            for (auto* const out : output)
+                std::fill_n (out, nframes, 0.0f);
+            return;
+        }
+
+        if constexpr (numOutputs == 1)
+            verb.processMono (input[0], output[0], nframes);
+        else
+            verb.processStereo (input[0], input[numInputs - 1], output[0], output[1], nframes);
     }
 
 private:
-    Reverb verb;
+    Engine verb;
     Reverb::Parameters params, cparams;
     double sampleRate;
     std::string bundlePath;
-    float* input[2];
-    float* output[2];
+    float* input[numInputs];
+    float* output[numOutputs];
 };
 } // namespace everb
 
-static const lvtk::Descriptor<everb::Module> __everb (EVERB_URI);
+static const lvtk::Descriptor<everb::Module<2, 2>> __everb (EVERB_URI);
+static const lvtk::Descriptor<everb::Module<1, 1>> __everbMono (EVERB_MONO_URI);
+static const lvtk::Descriptor<everb::Module<1, 2>> __everbMonoToStereo (EVERB_MONO_TO_STEREO_URI);
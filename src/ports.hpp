@@ -33,9 +33,39 @@ struct Ports {
         RoomSize = 6,
         Damping  = 7,
         Width    = 8,
+        Quality  = 9,
+        Network  = 10,
+        Size     = 11,
+
+        ReducedRate = 12, // CLAP only, as the LV2 plugins don't report latency
     };
 
     inline static constexpr uint32_t paramsBegin() noexcept { return Wet; }
     inline static constexpr uint32_t paramsEnd() noexcept { return Width + 1; }
 };
+
+// Hosts save CLAP automation and state by these ids, so they never change: new parameters
+// go after the last.
+static_assert (Ports::Quality == 9 && Ports::Network == 10 && Ports::Size == 11 && Ports::ReducedRate == 12,
+               "released parameter ids must not change");
+
+/** Port indices of an LV2 plugin with numInputs audio inputs and numOutputs audio outputs.
+
+    Each plugin lists its audio ports first and then the controls in the order of Ports, so
+    only the index of the first control differs. Ports::Wet to Ports::Width are used as the
+    control ids everywhere else; this maps them to and from the plugin's port indices.
+*/
+template <uint32_t numInputs, uint32_t numOutputs>
+struct PortLayout {
+    static constexpr uint32_t firstControl = numInputs + numOutputs;
+
+    inline static constexpr uint32_t toPort (uint32_t param) noexcept { return param - Ports::Wet + firstControl; }
+    inline static constexpr uint32_t toParam (uint32_t port) noexcept { return port - firstControl + Ports::Wet; }
+};
+
+using StereoLayout       = PortLayout<2, 2>;
+using MonoLayout         = PortLayout<1, 1>;
+using MonoToStereoLayout = PortLayout<1, 2>;
+
+static_assert (StereoLayout::firstControl == Ports::Wet, "the stereo plugin's ports are Ports");
 } // namespace everb
\ No newline at end of file
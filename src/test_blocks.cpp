@@ -0,0 +1,106 @@
+/*
+    This file is part of eVerb
+
+    Copyright (C) 2015-2025  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Runs the same signal through Reverb in one block and split in blocks of random sizes,
+// down to single frames, and checks the output is identical, at the host rate and with
+// the tank at a half and a quarter of it.
+
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "everb.hpp"
+
+namespace everb {
+namespace {
+
+constexpr int maxSplit = 700;
+
+std::unique_ptr<Reverb> createReverb (const double sampleRate, const int maxBlockSize) {
+    auto reverb = std::make_unique<Reverb>();
+    reverb->setKernels (Reverb::KernelTable::best());
+    reverb->setMinTankRate (48000.0);
+    reverb->prepare (sampleRate, maxBlockSize);
+
+    ReverbParameters params;
+    params.roomSize = 0.8f;
+    params.damping  = 0.3f;
+    reverb->setParameters (params);
+
+    // Skip the parameter ramps from the defaults, which are thinned per block at a reduced
+    // tank rate, then start from silence.
+    std::vector<float> left (maxSplit), right (maxSplit);
+    for (int done = 0; done < int (sampleRate); done += maxSplit)
+        reverb->processStereo (left.data(), right.data(), left.data(), right.data(), maxSplit);
+    reverb->reset();
+    return reverb;
+}
+
+// Half a second of noise, then a second of its tail, with the tank at the host rate over
+// factor.
+bool compare (const double sampleRate, const int factor) {
+    const int length = int (sampleRate * 1.5);
+
+    std::mt19937 random (1);
+    std::uniform_real_distribution<float> noise (-0.5f, 0.5f);
+    std::vector<float> left (length), right (length);
+    for (int i = 0; i < length / 3; ++i) {
+        left[i]  = noise (random);
+        right[i] = noise (random);
+    }
+
+    std::vector<float> wantL (length), wantR (length), gotL (length), gotR (length);
+    createReverb (sampleRate, length)->processStereo (left.data(), right.data(), wantL.data(), wantR.data(), length);
+
+    // A quarter of the blocks are 1 to 3 frames, shorter than the frames a reduced rate
+    // tank holds back.
+    auto reverb = createReverb (sampleRate, maxSplit);
+    std::uniform_int_distribution<int> tiny (1, 3), any (1, maxSplit);
+    for (int done = 0; done < length;) {
+        const int num = std::min (length - done, random() % 4 == 0 ? tiny (random) : any (random));
+        reverb->processStereo (left.data() + done, right.data() + done, gotL.data() + done, gotR.data() + done, num);
+        done += num;
+    }
+
+    int firstDifference = -1;
+    for (int i = 0; i < length && firstDifference < 0; ++i)
+        if (gotL[i] != wantL[i] || gotR[i] != wantR[i])
+            firstDifference = i;
+
+    const bool ok = firstDifference < 0;
+    std::printf ("%s %6.0f Hz, tank at %5.0f Hz: ", ok ? "ok  " : "FAIL", sampleRate, sampleRate / factor);
+    if (ok)
+        std::printf ("identical\n");
+    else
+        std::printf ("differs from frame %d\n", firstDifference);
+
+    return ok;
+}
+
+} // namespace
+} // namespace everb
+
+int main() {
+    juce::ScopedNoDenormals noDenormals;
+    const bool host    = everb::compare (48000.0, 1);
+    const bool half    = everb::compare (96000.0, 2);
+    const bool quarter = everb::compare (192000.0, 4);
+    return host && half && quarter ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+/*
+    This file is part of eVerb
+
+    Copyright (C) 2015-2025  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Runs ReverbCompact and Reverb on the same input and checks the half precision delay lines
+// stay within the error they were measured at, with the baseline and the best kernels.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "everb.hpp"
+
+namespace everb {
+namespace {
+
+constexpr double sampleRate = 48000.0;
+constexpr int blockSize     = 256;
+constexpr int numBlocks     = int (sampleRate) * 8 / blockSize;
+
+// Measured at about 66 dB and 7e-4, with some room for other compilers.
+constexpr double minSnr   = 60.0;
+constexpr double maxError = 1.0e-3;
+
+template <typename Engine>
+std::unique_ptr<Engine> createEngine (const bool best) {
+    auto engine = std::make_unique<Engine>();
+    engine->setKernels (best ? Engine::KernelTable::best() : Engine::KernelTable::baseline());
+    engine->prepare (sampleRate, blockSize);
+
+    ReverbParameters params;
+    params.roomSize = 0.8f;
+    params.wetLevel = 1.0f;
+    params.dryLevel = 0.0f;
+    engine->setParameters (params);
+    return engine;
+}
+
+// Noise bursts of 50 ms every half second for 4 seconds, then the tails.
+bool compare (const bool best) {
+    auto reference = createEngine<Reverb> (best);
+    auto compact   = createEngine<ReverbCompact> (best);
+
+    std::mt19937 random (1);
+    std::uniform_real_distribution<float> noise (-0.5f, 0.5f);
+
+    std::vector<float> left (blockSize), right (blockSize);
+    std::vector<float> refL (blockSize), refR (blockSize), outL (blockSize), outR (blockSize);
+
+    double signal = 0, error = 0, worst = 0;
+    for (int b = 0; b < numBlocks; ++b) {
+        for (int i = 0; i < blockSize; ++i) {
+            const int frame = b * blockSize + i;
+            const bool on   = frame < 4 * sampleRate && frame % int (sampleRate / 2) < int (sampleRate / 20);
+            left[i]         = on ? noise (random) : 0.0f;
+            right[i]        = on ? noise (random) : 0.0f;
+        }
+
+        reference->processStereo (left.data(), right.data(), refL.data(), refR.data(), blockSize);
+        compact->processStereo (left.data(), right.data(), outL.data(), outR.data(), blockSize);
+
+        const auto accumulate = [&] (const float* const want, const float* const got) {
+            for (int i = 0; i < blockSize; ++i) {
+                const double difference = double (got[i]) - want[i];
+                signal += double (want[i]) * want[i];
+                error += difference * difference;
+                worst = std::max (worst, std::abs (difference));
+            }
+        };
+
+        accumulate (refL.data(), outL.data());
+        accumulate (refR.data(), outR.data());
+    }
+
+    const double snr = 10.0 * std::log10 (signal / std::max (error, 1.0e-30));
+    const bool ok    = snr >= minSnr && worst <= maxError;
+    std::printf ("%s %-8s kernels: SNR %.1f dB (at least %.0f), max error %.2e (at most %.0e)\n",
+                 ok ? "ok  " : "FAIL", best ? Reverb::KernelTable::best().name : Reverb::KernelTable::baseline().name,
+                 snr, minSnr, worst, maxError);
+    return ok;
+}
+
+} // namespace
+} // namespace everb
+
+int main() {
+    juce::ScopedNoDenormals noDenormals;
+    const bool baseline = everb::compare (false);
+    const bool best     = everb::compare (true);
+    return baseline && best ? 0 : 1;
+}
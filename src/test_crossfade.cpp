@@ -0,0 +1,106 @@
+/*
+    This file is part of eVerb
+
+    Copyright (C) 2015-2025  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Switches TieredReverb's quality again before its crossfade has finished, and checks the
+// output glides: no step between two samples after the switches is much larger than the
+// largest before them. The input is a low sine, so the wet signal itself moves slowly.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+#include "everb.hpp"
+
+namespace everb {
+namespace {
+
+constexpr double sampleRate = 48000.0;
+constexpr int blockSize     = 64;
+constexpr int settleBlocks  = int (sampleRate) / blockSize;     // 1 s before the first switch
+constexpr int switchBlocks  = int (sampleRate) / 50 / blockSize; // 20 ms between switches
+constexpr int afterBlocks   = int (sampleRate) / 2 / blockSize;  // then half a second
+
+// How much larger a step may get than the largest of the steady sound before.
+constexpr double maxStepRatio = 1.5;
+
+bool switches (const char* const name, const std::initializer_list<ReverbQuality> tiers) {
+    auto reverb = std::make_unique<TieredReverb<2>>();
+    reverb->useBestKernels();
+    reverb->prepare (sampleRate, blockSize);
+
+    ReverbParameters params;
+    params.roomSize = 0.7f;
+    params.wetLevel = 1.0f;
+    params.dryLevel = 0.0f;
+    params.quality  = (float) ReverbQuality::standard;
+    reverb->setParameters (params);
+
+    std::vector<float> left (blockSize), right (blockSize);
+    float last = 0.0f;
+    double steady = 0, switched = 0;
+    int frame = 0;
+
+    const auto run = [&] (const int numBlocks, double& largest) {
+        for (int b = 0; b < numBlocks; ++b) {
+            for (int i = 0; i < blockSize; ++i, ++frame)
+                left[i] = right[i] = 0.5f * (float) std::sin (2.0 * juce::MathConstants<double>::pi * 100.0 * frame / sampleRate);
+
+            reverb->processStereo (left.data(), right.data(), left.data(), right.data(), blockSize);
+
+            for (int i = 0; i < blockSize; ++i) {
+                largest = std::max (largest, (double) std::abs (left[i] - last));
+                last    = left[i];
+            }
+        }
+    };
+
+    // Skip the first half second, where the tail builds up.
+    double ignored = 0;
+    run (settleBlocks / 2, ignored);
+    run (settleBlocks / 2, steady);
+
+    for (const auto tier : tiers) {
+        params.quality = (float) tier;
+        reverb->setParameters (params);
+        run (switchBlocks, switched);
+    }
+
+    run (afterBlocks, switched);
+
+    const double ratio = switched / steady;
+    const bool ok      = ratio <= maxStepRatio;
+    std::printf ("%s %-34s largest step %.2fx the steady one (at most %.1fx)\n",
+                 ok ? "ok  " : "FAIL", name, ratio, maxStepRatio);
+    return ok;
+}
+
+} // namespace
+} // namespace everb
+
+int main() {
+    using everb::ReverbQuality;
+    juce::ScopedNoDenormals noDenormals;
+    const bool back  = everb::switches ("standard, dense, back to standard", { ReverbQuality::dense, ReverbQuality::standard });
+    const bool third = everb::switches ("standard, dense, eco", { ReverbQuality::dense, ReverbQuality::eco });
+    const bool round = everb::switches ("standard, dense, eco, standard", { ReverbQuality::dense, ReverbQuality::eco, ReverbQuality::standard });
+    return back && third && round ? 0 : 1;
+}
@@ -0,0 +1,228 @@
+/*
+    This file is part of eVerb
+
+    Copyright (C) 2015-2025  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Feeds a reverb a burst of noise and then silence for long enough that its tail decays
+// through the denormal range, with flush-to-zero set as the plugins set it. Fails if any
+// delay line or output sample goes subnormal, or if the late blocks of silence cost more
+// than the early ones. The kernels carry no denormal guards of their own, so this is what
+// keeps them honest, on the calling thread and on a TaskPool's.
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "everb.hpp"
+
+namespace everb {
+namespace {
+
+constexpr double sampleRate = 48000.0;
+constexpr int blockSize     = 1024;
+constexpr int blocksPerSec  = int (sampleRate) / blockSize;
+constexpr int excitedBlocks = blocksPerSec;      // 1 s of noise
+constexpr int silentBlocks  = 14 * blocksPerSec; // then 14 s of silence
+
+// How much more the last second of silence may cost than the first. A tail running through
+// denormals costs many times more.
+constexpr double maxSlowdown = 1.5;
+
+// A pool of one thread, started before the test sets flush-to-zero so the thread runs with
+// the default floating point mode, as a host's pool thread would. Task 0 runs on the
+// caller, the others on the thread.
+class WorkerPool final : public TaskPool {
+public:
+    WorkerPool() : worker ([this] { work(); }) {}
+
+    ~WorkerPool() override {
+        {
+            const std::lock_guard<std::mutex> lock (mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        worker.join();
+    }
+
+    bool run (const Task newTask, void* const newContext, const int numTasks) noexcept override {
+        {
+            const std::lock_guard<std::mutex> lock (mutex);
+            task      = newTask;
+            context   = newContext;
+            remaining = numTasks - 1;
+            pending   = true;
+        }
+        wake.notify_all();
+
+        newTask (newContext, 0);
+
+        std::unique_lock<std::mutex> lock (mutex);
+        done.wait (lock, [this] { return ! pending; });
+        return true;
+    }
+
+private:
+    void work() {
+        std::unique_lock<std::mutex> lock (mutex);
+        for (;;) {
+            wake.wait (lock, [this] { return pending || quit; });
+            if (quit)
+                return;
+
+            for (int index = 1; index <= remaining; ++index)
+                task (context, index);
+
+            pending = false;
+            done.notify_all();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    Task task       = nullptr;
+    void* context   = nullptr;
+    int remaining   = 0;
+    bool pending    = false;
+    bool quit       = false;
+    std::thread worker;
+};
+
+// Looks at the bits, as with denormals-are-zero set comparisons take subnormals for zero.
+template <typename SampleType>
+bool isSubnormal (const SampleType* const samples, const int numSamples) {
+    using Bits = std::conditional_t<sizeof (SampleType) == 4, std::uint32_t, std::uint64_t>;
+    constexpr int mantissaBits = std::numeric_limits<SampleType>::digits - 1;
+    constexpr Bits mantissa    = (Bits (1) << mantissaBits) - 1;
+    constexpr Bits magnitude   = ~Bits (0) >> 1;
+
+    for (int i = 0; i < numSamples; ++i) {
+        Bits bits;
+        std::memcpy (&bits, samples + i, sizeof (bits));
+        if ((bits & magnitude) != 0 && (bits & magnitude) <= mantissa)
+            return true;
+    }
+    return false;
+}
+
+// A denormal tail slows every block, while a block the scheduler holds up is only slow on its
+// own, so the fastest block is the steadiest measure of the cost.
+double fastest (const std::vector<double>& values) {
+    return *std::min_element (values.begin(), values.end());
+}
+
+// Runs Engine, of numChannels, on IOType buffers: processStereo() for two channels,
+// otherwise processChannels().
+template <typename Engine, typename IOType, int numChannels>
+bool decay (const char* const name, TaskPool* const pool) {
+    auto engine = std::make_unique<Engine>();
+    engine->setKernels (Engine::KernelTable::best());
+    engine->setTaskPool (pool, blockSize / 2);
+    engine->prepare (sampleRate, blockSize);
+
+    // A small room, so the tail gets down to the denormals within the test.
+    ReverbParameters params;
+    params.roomSize = 0.2f;
+    params.damping  = 0.2f;
+    params.wetLevel = 1.0f;
+    params.dryLevel = 0.0f;
+    engine->setParameters (params);
+
+    const juce::ScopedNoDenormals noDenormals;
+
+    std::mt19937 random (1);
+    std::uniform_real_distribution<IOType> noise (-0.5, 0.5);
+    std::vector<IOType> buffers (size_t (2 * numChannels) * blockSize);
+    IOType* ins[numChannels];
+    IOType* outs[numChannels];
+    for (int c = 0; c < numChannels; ++c) {
+        ins[c]  = buffers.data() + size_t (c) * blockSize;
+        outs[c] = buffers.data() + size_t (numChannels + c) * blockSize;
+    }
+
+    int firstSubnormal = -1;
+    std::vector<double> early, late;
+
+    for (int b = 0; b < excitedBlocks + silentBlocks; ++b) {
+        for (auto* const in : ins)
+            for (int i = 0; i < blockSize; ++i)
+                in[i] = b < excitedBlocks ? noise (random) : IOType();
+
+        const auto start = std::chrono::steady_clock::now();
+        if constexpr (numChannels == 2)
+            engine->processStereo (ins[0], ins[1], outs[0], outs[1], blockSize);
+        else
+            engine->processChannels (ins, outs, blockSize);
+        const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+        const int silent = b - excitedBlocks;
+        if (silent >= 0 && silent < blocksPerSec)
+            early.push_back (elapsed.count());
+        else if (silent >= silentBlocks - blocksPerSec)
+            late.push_back (elapsed.count());
+
+        bool subnormal = false;
+        for (const auto* const out : outs)
+            subnormal = subnormal || isSubnormal (out, blockSize);
+
+        // The noise has written every line all the way round by now.
+        if (b >= excitedBlocks) {
+            engine->visitDelayLines ([&] (const auto* const line, const int size) {
+                subnormal = subnormal || isSubnormal (line, size);
+            });
+        }
+
+        if (subnormal && firstSubnormal < 0)
+            firstSubnormal = b;
+    }
+
+    const double slowdown = fastest (late) / fastest (early);
+    const bool ok         = firstSubnormal < 0 && slowdown <= maxSlowdown;
+    std::printf ("%s %-16s late blocks %.2fx the early ones (at most %.1fx), ",
+                 ok ? "ok  " : "FAIL", name, slowdown, maxSlowdown);
+
+    if (firstSubnormal < 0)
+        std::printf ("no subnormals\n");
+    else
+        std::printf ("subnormal samples from %.2f s\n", double (firstSubnormal) / blocksPerSec);
+
+    return ok;
+}
+
+} // namespace
+} // namespace everb
+
+int main() {
+    using namespace everb;
+
+    WorkerPool pool;
+
+    bool ok = decay<Reverb, float, 2> ("Reverb", nullptr);
+    ok      = decay<Reverb, double, 2> ("Reverb, 64-bit io", nullptr) && ok;
+    ok      = decay<Reverb, float, 2> ("Reverb, pooled", &pool) && ok;
+    ok      = decay<ReverbEngine<8, 4, 6, float>, float, 6> ("5.1, pooled", &pool) && ok;
+    return ok ? 0 : 1;
+}
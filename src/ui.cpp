@@ -37,7 +37,9 @@
 #include "content.hpp"
 #include "ports.hpp"
 
-#define EVERB_UI_URI "https://kushview.net/plugins/everb/ui"
+#define EVERB_UI_URI                "https://kushview.net/plugins/everb/ui"
+#define EVERB_MONO_UI_URI           "https://kushview.net/plugins/everb/mono/ui"
+#define EVERB_MONO_TO_STEREO_UI_URI "https://kushview.net/plugins/everb/mono-to-stereo/ui"
 
 namespace everb {
 
@@ -52,12 +54,18 @@ private:
     bool& value;
 };
 
-class eVerbUI final : public lvtk::UI<eVerbUI, lvtk::Parent, lvtk::Idle, lvtk::URID, lvtk::Options> {
+/** The UI of the plugin with port layout Layout. The controls are the same in all of them,
+    only their port indices differ.
+*/
+template <class Layout>
+class eVerbUI final : public lvtk::UI<eVerbUI<Layout>, lvtk::Parent, lvtk::Idle, lvtk::URID, lvtk::Options> {
 public:
+    using UI = lvtk::UI<eVerbUI<Layout>, lvtk::Parent, lvtk::Idle, lvtk::URID, lvtk::Options>;
+
     eVerbUI (const lvtk::UIArgs& args)
         : UI (args),
           _main (lui::Mode::MODULE, std::make_unique<lui::Cairo>()) {
-        for (const auto& opt : lvtk::OptionArray (options())) {
+        for (const auto& opt : lvtk::OptionArray (this->options())) {
             lvtk::ignore (opt);
         }
 
@@ -78,7 +86,7 @@ public:
     void send_control (uint32_t port, float value) {
         if (_block_sending)
             return;
-        write (port, value);
+        this->write (Layout::toPort (port), value);
     }
 
     void port_event (uint32_t port, uint32_t size, uint32_t format, const void* buffer) {
@@ -86,13 +94,13 @@ public:
             return;
 
         ScopedFlag sf (_block_sending, true);
-        content->update_slider ((int) port, lvtk::read_unaligned<float> (buffer));
+        content->update_slider (Layout::toParam (port), lvtk::read_unaligned<float> (buffer));
     }
 
     LV2UI_Widget widget() {
         if (content == nullptr) {
             content = std::make_unique<Content>();
-            _main.elevate (*content, 0, (uintptr_t) parent.get());
+            _main.elevate (*content, 0, (uintptr_t) this->parent.get());
             content->set_visible (true);
             content->on_control_changed = std::bind (
                 &eVerbUI::send_control, this, std::placeholders::_1, std::placeholders::_2);
@@ -107,5 +115,9 @@ private:
 };
 } //namespace everb
 
-static lvtk::UIDescriptor<everb::eVerbUI> __eVerbUI (
+static lvtk::UIDescriptor<everb::eVerbUI<everb::StereoLayout>> __eVerbUI (
     EVERB_UI_URI, { LV2_UI__parent });
+static lvtk::UIDescriptor<everb::eVerbUI<everb::MonoLayout>> __eVerbMonoUI (
+    EVERB_MONO_UI_URI, { LV2_UI__parent });
+static lvtk::UIDescriptor<everb::eVerbUI<everb::MonoToStereoLayout>> __eVerbMonoToStereoUI (
+    EVERB_MONO_TO_STEREO_UI_URI, { LV2_UI__parent });